@@ -0,0 +1,3745 @@
+// the Apriori engine shared by the four programs: every function is a static member of Apriori, templated
+// on an execution policy that provides the thread and rank counts and the collectives, so that the serial
+// and OpenMP programs contain no MPI code and the policy calls of the single process compile away. The
+// OpenMP pragmas are active only in the programs built with -fopenmp. The result keys itemsets on their item
+// strings; the level-wise counting and the rule and output tables work on integer item ids, templated on their
+// width
+#ifndef APRIORI_ENGINE_H
+#define APRIORI_ENGINE_H
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <iostream>
+#include <fstream>
+#include <string.h>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <unordered_map>
+#include <set>
+#include <queue>
+#include <deque>
+#include <algorithm>
+#include <random>
+#include <iterator>
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "apriori_input.h"
+#ifdef APRIORI_PERF
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#endif
+using namespace std;
+
+const float MIN_CONFIDENCE = 1.; // default of -confidence
+const double CONFIDENCE_TOLERANCE = 1e-6; // relative, above the rounding of -confidence to a float
+const int RULES_TEXT = 0, RULES_TSV = 1, RULES_BINARY = 2; // formats of the rules output
+const char RULES_MAGIC[] = "APRRUL01"; // first 8 bytes of a binary rules file
+const int ITEMSETS_TSV = 0, ITEMSETS_JSONL = 1, ITEMSETS_BINARY = 2; // formats of the itemsets output
+const char ITEMSETS_MAGIC[] = "APRSET01"; // first 8 bytes of a binary itemsets file
+const int STREAM_BUFFER_SIZE = 1 << 20; // bytes read from or written to a spill file at once
+const int RESCAN_CHUNK_ROWS = 100000; // rows of the old data read at once by the incremental update
+const char LATTICE_MAGIC[] = "APRLAT01"; // first 8 bytes of a lattice file
+const int SAMPLE_SEED = 12345; // seed of the row sampling, fixed so that runs are reproducible
+const int NARROW_ITEMS = 1 << 16; // items that fit the 16-bit item ids of the itemset tables
+const char CHECKPOINT_MAGIC[] = "APRCKP02"; // first 8 bytes of a checkpoint file
+const int LOAD_BATCH_ROWS = 4096; // lines parsed and counted by one task of read_file
+#ifdef APRIORI_PERF
+// hardware events counted around the counting and candidate generation phases
+const int PERF_EVENTS = 5;
+const char* PERF_NAMES[PERF_EVENTS] = {"cycles", "instructions", "llc_misses", "branch_misses", "dtlb_misses"};
+const unsigned int PERF_TYPES[PERF_EVENTS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE};
+const unsigned long long PERF_CONFIGS[PERF_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+#endif
+
+// hash of an itemset of item ids, for the support lookups of the rule generation
+struct ItemsetHash{
+    template <class Item>
+    size_t operator()(const vector<Item> &itemset) const{
+        size_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < itemset.size(); i++){
+            hash = (hash ^ itemset[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+};
+
+// time spent in each phase of a level of the level-wise mining and the size of the level, for -trace
+struct LevelTrace{
+    int k = 0;
+    int candidates = 0; // candidates counted, as generated
+    int frequent = 0;
+    double count_time = 0; // candidates counted over the rows of the slowest rank
+    double normalise_time = 0;
+    double reduce_time = 0; // counts summed on rank 0
+    double prune_time = 0;
+    double broadcast_time = 0; // frequent itemsets sent back to every rank
+    double generation_time = 0; // update_candidates
+    vector<long long> count_events; // hardware counters of the counting on rank 0, built with APRIORI_PERF
+    vector<long long> generation_events; // hardware counters of update_candidates
+    long long bytes_sent = 0; // by this rank in the reduction and the broadcast
+    vector<double> thread_times; // counting time of every thread of rank 0
+    vector< vector<long long> > thread_events; // hardware counters of the counting of every thread
+};
+
+// run trace written by -trace: the phases outside the levels and every level traced
+struct RunTrace{
+    double load_time = 0;
+    double fused_time = 0; // fused passes, whose levels are counted together
+    double depth_first_time = 0; // depth-first continuation of the hybrid engine
+    vector<LevelTrace> levels;
+};
+
+// candidates of the level-wise mining as a prefix tree of item ids, packed in one buffer and read in place: the
+// number of nodes, the first child of every node followed by the end of the last one, the item of every node and
+// whether a candidate ends there. Node 0 is the root; the children of a node follow the ones of the node before
+// it, sorted by item, so a row is matched against them with binary searches. Only a view, the buffer belongs to
+// its builder, or with -shared to the window of the policy
+template <class Item>
+struct CandidateTrie{
+    int n_nodes = 0;
+    const int* first = NULL;
+    const Item* items = NULL;
+    const char* ends = NULL;
+
+    static size_t packed_size(int n_nodes){ return sizeof(int)*(n_nodes + 2) + sizeof(Item)*n_nodes + n_nodes; }
+
+    static void pack(vector<int> &first, vector<Item> &items, vector<char> &ends, char* buffer){
+        int n_nodes = items.size();
+
+        memcpy(buffer, &n_nodes, sizeof(int));
+        buffer += sizeof(int);
+        memcpy(buffer, first.data(), sizeof(int)*(n_nodes + 1));
+        buffer += sizeof(int)*(n_nodes + 1);
+        memcpy(buffer, items.data(), sizeof(Item)*n_nodes);
+        buffer += sizeof(Item)*n_nodes;
+        memcpy(buffer, ends.data(), n_nodes);
+    }
+
+    void view(const char* buffer){
+        n_nodes = *(const int*)buffer;
+        first = (const int*)buffer + 1;
+        items = (const Item*)(first + n_nodes + 1);
+        ends = (const char*)(items + n_nodes);
+    }
+
+    bool empty() const{ return n_nodes <= 1; }
+};
+
+// single process: rank 0 of 1, every collective leaves its arguments as they are
+struct SerialPolicy{
+    static const bool distributed = false;
+    static const bool threads = false;
+
+    static const char* program(){ return "apriori"; }
+    static void init(int &my_rank, int &comm_sz){ my_rank = 0; comm_sz = 1; }
+    static void finalize(){}
+    static void abort(){ exit(1); }
+    static int max_threads(){ return 1; }
+    static int thread_num(){ return 0; }
+
+    static long long collect_itemsets(map<string,float> &, int, int){ return 0; }
+    static long long broadcast_itemsets(vector<string> &, int){ return 0; }
+    static void share_dictionary(map<string,float> &, int){}
+    static void gather_text(string &, int, int){}
+    static void gather_tids(vector< vector<int> > &, int){}
+    static long long broadcast_leaders(vector<string> &, int){ return 0; }
+    static long long sum_node_counts(vector<int> &){ return 0; }
+    static bool node_leader(){ return true; }
+    template <class T> static void broadcast(T &){}
+    template <class T> static T sum_all(T value){ return value; }
+    template <class T> static T exclusive_sum(T){ return 0; }
+    template <class T> static void reduce_sum(T* values, T* result, int n){ copy(values, values + n, result); }
+    template <class T> static void reduce_min(T* values, T* result, int n){ copy(values, values + n, result); }
+    template <class T> static void reduce_max(T* values, T* result, int n){ copy(values, values + n, result); }
+
+    // write buffer at offset of file, which is truncated first, false if it cannot be written
+    static bool write_file(char file[], long long, vector<char> &buffer){
+        FILE* out = fopen(file, "wb");
+        bool written;
+
+        if(out == NULL) return false;
+        written = fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+        return fclose(out) == 0 && written;
+    }
+
+    // the buffer of the node leader, read in place by the ranks of its node: the process is its own node
+    static const char* share_buffer(vector<char> &buffer){ return buffer.data(); }
+};
+
+#ifdef _OPENMP
+// threads of a single process
+struct OpenMPPolicy : SerialPolicy{
+    static const bool threads = true;
+
+    static const char* program(){ return "apriori_omp"; }
+    static int max_threads(){ return omp_get_max_threads(); }
+    static int thread_num(){ return omp_get_thread_num(); }
+};
+#endif
+
+// the miner on the execution policy Policy: run parses the options and mines the file, the other members are
+// its phases, also called by the programs in bench
+template <class Policy>
+class Apriori{
+public:
+    static int run(int argc, char* argv[]);
+    static int count_file_lines(char file_name[]);
+    static void check_input(LineReader &myfile, char file_name[]);
+    static string check_output(char file[]);
+    static void compute_local_start_end(char file_name[], int my_rank, int comm_sz, int *local_start, int *local_end);
+    static void compute_local_range(int tot_lines, int my_rank, int comm_sz, int *local_start, int *local_end);
+    static void read_file(char file_name[], int local_start, int local_end, vector< vector<string> > &matrix, map<string,float> &dictionary);
+    static void read_file(char file_name[], int local_start, int local_end, vector< vector<string> > &matrix, map<string,float> &dictionary, const vector<string>* items);
+    static void parse_rows(vector<string> &lines, vector< vector<string> > &rows, map<string,float> &counts, const vector<string>* items);
+    static void trim_rows(vector< vector<string> > &matrix, const vector<string> &items);
+    static void normalise(map<string,float> &dictionary, int tot_lines);
+    static void mine_matrix(vector< vector<string> > &matrix, map<string,float> &dictionary, int tot_lines, float min_support, int fuse_threshold, int fuse_depth, float hybrid_budget, bool shared, int local_start, int my_rank, int comm_sz, char checkpoint_file[], bool checkpoint_rows, vector<string> &checkpoint_key, RunTrace &trace);
+    static void prune_items(map<string,float> &dictionary, vector<string> &candidates, vector<string> &single_candidates, float min_support, int tot_lines, bool shared, int my_rank, int comm_sz, RunTrace &trace);
+    static int load_frequent(char file_name[], int local_start, int local_end, vector< vector<string> > &matrix, map<string,float> &dictionary, vector<string> &candidates, vector<string> &single_candidates, float min_support, bool shared, int my_rank, int comm_sz, RunTrace &trace);
+    static void mine_levels(vector< vector<string> > &matrix, map<string,float> &dictionary, vector<string> &candidates, vector<string> &single_candidates, int n, int tot_lines, float min_support, int max_length, int fuse_threshold, int fuse_depth, float hybrid_budget, bool shared, int local_start, int my_rank, int comm_sz, char checkpoint_file[], bool checkpoint_rows, vector<string> &checkpoint_key, RunTrace &trace);
+    template <class Item>
+    static void mine_id_levels(vector< vector<string> > &matrix, vector<string> &items, map<string,float> &dictionary, vector<string> &candidates, vector<string> &single_candidates, int n, int tot_lines, float min_support, int max_length, int fuse_threshold, int fuse_depth, float hybrid_budget, bool shared, int local_start, int my_rank, int comm_sz, char checkpoint_file[], bool checkpoint_rows, vector<string> &checkpoint_key, RunTrace &trace);
+    template <class Item>
+    static void write_checkpoint(char checkpoint_file[], vector< vector<Item> > &rows, vector<string> &row_items, map<string,float> &dictionary, vector<string> &candidates, vector<string> &single_candidates, int n, int tot_lines, float min_support, bool with_rows, vector<string> &key, int my_rank, int comm_sz);
+    static int read_checkpoint(char checkpoint_file[], char file_name[], int local_start, int local_end, vector< vector<string> > &matrix, map<string,float> &dictionary, vector<string> &candidates, vector<string> &single_candidates, int &tot_lines, float min_support, vector<string> &key, int my_rank, int comm_sz);
+    static void make_checkpoint_key(char file_name[], int fuse_threshold, int fuse_depth, float hybrid_budget, vector<string> &key);
+    static void append_strings(vector<char> &buffer, vector<string> &strings);
+    static void read_strings(ifstream &in, vector<string> &strings);
+    static void count_itemsets(vector< vector<string> > &rows, vector<string> &candidates, map<string,float> &counts);
+    template <class Item>
+    static void count_ids(vector< vector<string> > &rows, vector<string> &candidates, vector<string> &items, map<string,float> &counts);
+    template <class Item>
+    static void encode_rows(vector< vector<string> > &matrix, vector<string> &items, vector< vector<Item> > &rows);
+    template <class Item>
+    static void candidate_trie(vector<string> &candidates, vector<string> &items, bool shared, vector<char> &buffer, CandidateTrie<Item> &trie);
+    template <class Item>
+    static void build_trie(vector<string> &candidates, vector<string> &items, vector<char> &buffer);
+    template <class Item>
+    static void count_trie(vector< vector<Item> > &rows, CandidateTrie<Item> &trie, vector<int> &counts, LevelTrace &level);
+    template <class Item>
+    static void count_row(vector<Item> &row, size_t pos, int node, CandidateTrie<Item> &trie, vector<int> &counts);
+    template <class Item>
+    static void trie_counts(CandidateTrie<Item> &trie, vector<string> &items, vector<int> &counts, int node, string itemset, map<string,float> &dictionary);
+    static void prune_itemsets(map<string,float> &temp_dictionary, vector<string> &candidates, float min_support, int tot_lines, int my_rank, int comm_sz, vector<string> &single_candidates);
+    static void prune_itemsets(map<string,float> &temp_dictionary, vector<string> &candidates, float min_support, int tot_lines, int my_rank, int comm_sz, vector<string> &single_candidates, LevelTrace &level);
+    static void reduce_itemsets(map<string,float> &temp_dictionary, float min_support, int tot_lines, int my_rank, int comm_sz, vector<string> &freq_itemsets);
+    static void reduce_itemsets(map<string,float> &temp_dictionary, float min_support, int tot_lines, int my_rank, int comm_sz, vector<string> &freq_itemsets, LevelTrace &level);
+    static void collect_frequent(map<string,float> &temp_dictionary, float min_support, int tot_lines, int my_rank, int comm_sz, vector<string> &freq_itemsets, LevelTrace &level);
+    static void update_candidates(vector<string> &candidates, vector<string> freq_itemsets, vector<string> &single_candidates);
+    static void share_candidates(map<string,float> &temp_dictionary, float min_support, int tot_lines, int my_rank, int comm_sz, vector<string> &candidates, vector<string> &single_candidates, LevelTrace &level);
+    static void share_singles(vector<string> &single_candidates, int my_rank, LevelTrace &level);
+    static void speculate_levels(vector<string> &candidates, vector<string> &single_candidates, int fuse_threshold, int fuse_depth, vector< vector<string> > &levels, vector< vector<string> > &level_singles);
+    template <class Item>
+    static void fused_pass(vector< vector<Item> > &rows, vector<string> &row_items, vector<string> &candidates, vector<string> &single_candidates, map<string,float> &dictionary, float min_support, int tot_lines, int &n, int fuse_threshold, int fuse_depth, bool shared, int my_rank, int comm_sz);
+    static void reduce_levels(map<string,float> &fused_dictionary, int n_levels, vector<string> &candidates, vector<string> &single_candidates, map<string,float> &dictionary, float min_support, int tot_lines, int &n, bool shared, int my_rank, int comm_sz);
+    static void level_itemsets(map<string,float> &dictionary, int k, vector<string> &itemsets);
+    template <class Item>
+    static bool choose_depth_first(vector< vector<Item> > &rows, vector<string> &row_items, int n_candidates, vector<string> &single_candidates, map<string,float> &dictionary, vector<string> &freq_itemsets, int n, int tot_lines, float hybrid_budget, int my_rank);
+    template <class Item>
+    static void depth_first_mining(vector< vector<Item> > &rows, vector<string> &row_items, vector<string> &single_candidates, vector<string> &freq_itemsets, map<string,float> &dictionary, float min_support, int tot_lines, int local_start, int my_rank, int comm_sz);
+    static void extend_itemset(int i, vector<string> &itemsets, vector<string> &last_items, vector< vector<int> > &tids, map<string,float> &itemsets_found, float min_support, int n_rows);
+    static int count_items(char file_name[], int local_start, int local_end, map<string,float> &dictionary);
+    static void write_spill_file(char file_name[], int local_start, int local_end, char spill_file[], vector<string> &item_names);
+    static void encode_varint(unsigned int value, vector<char> &buffer);
+    static bool decode_varint(vector<char> &buffer, int &pos, int buffer_end, unsigned int &value);
+    template <class Item>
+    static bool read_spill_block(ifstream &spill, vector<char> &buffer, int &buffer_start, int &buffer_end, vector< vector<Item> > &block);
+    static int stream_mining(char file_name[], char spill_file[], map<string,float> &dictionary, float min_support, int fuse_threshold, int fuse_depth, int my_rank, int comm_sz);
+    template <class Item>
+    static void stream_levels(string &spill_file, vector<string> &item_names, vector<string> &candidates, vector<string> &single_candidates, map<string,float> &dictionary, float min_support, int tot_lines, int fuse_threshold, int fuse_depth, int my_rank, int comm_sz);
+    static int read_chunk(LineReader &myfile, int max_rows, vector< vector<string> > &matrix);
+    static void mine_chunk(vector< vector<string> > &matrix, float min_support, map<string,float> &itemsets_found);
+    static void count_candidates(vector<string> &row, set<string> &candidates, map<string,float> &counts, int item_idx, string itemset);
+    static int partition_mining(char file_name[], int chunk_rows, map<string,float> &dictionary, float min_support, int my_rank, int comm_sz);
+    static void sample_mining(vector< vector<string> > &matrix, map<string,float> &dictionary, int tot_lines, float min_support, float sample_fraction, float sample_support, int fuse_threshold, int fuse_depth, float hybrid_budget, int my_rank, int comm_sz);
+    static void negative_border(set<string> &itemsets, set<string> &border);
+    static int fup_mining(char file_name[], char delta_file[], char state_file[], map<string,float> &dictionary, float min_support, int my_rank, int comm_sz);
+    static void save_state(char state_file[], map<string,float> &dictionary, int n_rows, float min_support);
+    static void load_state(char state_file[], map<string,float> &counts, int &n_rows, float &min_support);
+    static void topk_mining(vector< vector<string> > &matrix, map<string,float> &dictionary, int tot_lines, float min_support, int k, int max_length, int my_rank, int comm_sz);
+    static void prune_topk(map<string,float> &temp_dictionary, priority_queue<float, vector<float>, greater<float> > &top_supports, int k, float &min_support, int tot_lines, vector<string> &candidates, vector<string> &single_candidates, int my_rank, int comm_sz);
+    static void raise_threshold(map<string,float> &temp_dictionary, priority_queue<float, vector<float>, greater<float> > &top_supports, int k, float &min_support);
+    static void closed_mining(vector< vector<string> > &matrix, map<string,float> &dictionary, int tot_lines, float min_support, bool maximal, int local_start, int my_rank, int comm_sz);
+    static void extend_closed(vector<int> &itemset, vector<int> &tids, int core, vector< vector<int> > &item_tids, vector<string> &items, int min_count, bool maximal, map<string,float> &itemsets_found, vector< vector<int> > &maximal_found, int n_rows);
+    static void expand_closed(vector<int> &itemset, vector<int> &tids, int e, vector< vector<int> > &item_tids, vector<string> &items, int min_count, bool maximal, map<string,float> &itemsets_found, vector< vector<int> > &maximal_found, int n_rows);
+    static void add_closed_itemset(vector<int> &itemset, int count, vector<string> &items, map<string,float> &itemsets_found, vector< vector<int> > &maximal_found, int n_rows);
+    static void write_trace(char trace_file[], RunTrace &trace, int n_rows, double elapsed, int my_rank, int comm_sz);
+    static double wall_time();
+    static void perf_start(vector<int> &fds);
+    static void perf_stop(vector<int> &fds, vector<long long> &values);
+    static void perf_sum(vector< vector<long long> > &thread_values, vector<long long> &values);
+    static void write_events(FILE* out, vector<long long> &values);
+    static long peak_rss();
+    static void write_lattice(char lattice_file[], map<string,float> &dictionary, int n_rows, float min_support);
+    static void generate_association_rules(map<string,float> &dictionary, int n_rows, float min_confidence, float min_lift, char rules_file[], int format, int my_rank, int comm_sz);
+    template <class Item>
+    static void generate_rules(map<string,float> &dictionary, int n_rows, float min_confidence, float min_lift, int format, FILE* out, bool streaming, int my_rank, int comm_sz, vector<char> &buffer);
+    static bool narrow_ids(map<string,float> &dictionary);
+    template <class Item>
+    static void build_itemset_table(map<string,float> &dictionary, vector<string> &items, vector< vector<Item> > &itemsets, vector<float> &supports);
+    template <class Item>
+    static void itemset_rules(vector<Item> &itemset, float support, int n_rows, vector<string> &items, unordered_map<vector<Item>, float, ItemsetHash> &support_table, float min_confidence, float min_lift, int format, vector<char> &buffer);
+    static void write_itemsets(map<string,float> &dictionary, int n_rows, char out_file[], int format, int my_rank, int comm_sz);
+    template <class Item>
+    static void format_itemsets(map<string,float> &dictionary, int n_rows, int format, int my_rank, int comm_sz, vector<char> &buffer);
+    template <class Item>
+    static void format_itemset(vector<char> &buffer, int format, vector<Item> &itemset, vector<string> &items, float support, int n_rows);
+    static void write_itemsets_header(vector<char> &buffer, int format, vector<string> &items, int n_rows);
+    static void write_rules_header(vector<char> &buffer, int format, vector<string> &items);
+    template <class Item>
+    static void write_rule(vector<char> &buffer, int format, vector<Item> &antecedent, vector<Item> &consequent, vector<string> &items, float support, float conf, float lift, float leverage);
+    template <class Item>
+    static void append_ids(vector<char> &buffer, vector<Item> &ids);
+    static void flush_rules(vector<char> &buffer, FILE* out);
+    template <class Item>
+    static string itemset_name(vector<Item> &itemset, vector<string> &items);
+};
+
+// ------------------------------------------------------------
+// Main
+// ------------------------------------------------------------
+
+// ./<program> <file> <min support> [options], the options are listed in the README
+template <class Policy>
+int Apriori<Policy>::run(int argc, char* argv[]){
+    int my_rank, comm_sz;
+    Policy::init(my_rank, comm_sz);
+    if(argc < 3){
+        if(my_rank == 0){
+            cout<<"Usage: "<<argv[0]<<" <file> <min support> [options]"<<endl;
+        }
+        Policy::finalize();
+        return 1;
+    }
+
+    char* file_name = argv[1];
+    float min_support = atof(argv[2]);
+    int fuse_threshold = 0; // 0 = one scan per level
+    int fuse_depth = 2; // levels counted together in a fused scan, 0 = all remaining
+    float hybrid_budget = 0; // MB available to the depth-first continuation, 0 = breadth-first only
+    char* stream_file = NULL; // spill file of the out-of-core mode, NULL = dataset kept in memory
+    int partition_rows = 0; // rows per chunk of the Partition mode, 0 = level-wise
+    float sample_fraction = 0; // fraction of rows mined by the sampling mode, 0 = level-wise
+    float sample_support = -1; // lowered min support used on the sample, -1 = 0.8*min_support
+    char* state_file = NULL; // state saved by a previous run on file_name, read by the incremental update
+    char* delta_file = NULL; // rows appended to file_name since state_file was saved, NULL = full mining
+    char* save_file = NULL; // state written for a later incremental update, NULL = none
+    char* lattice_file = NULL; // indexed lattice of every frequent itemset for lattice_query, NULL = none
+    int topk = 0; // number of most frequent itemsets of the top-K mode, 0 = every frequent itemset
+    int max_length = 0; // longest itemset of the top-K mode, 0 = any length
+    bool closed = false; // output only the closed itemsets
+    bool shared = false; // candidates of every level generated once per node and shared by its ranks
+    bool maximal = false; // output only the maximal itemsets
+    bool rules = false; // print the association rules of the frequent itemsets
+    float min_confidence = MIN_CONFIDENCE;
+    float min_lift = 0; // 0 = rules not filtered by lift
+    char* rules_file = NULL; // file the rules are streamed to, NULL = stdout
+    int rules_format = RULES_TEXT;
+    char* out_file = NULL; // file the itemsets are written to, NULL = stdout
+    int out_format = ITEMSETS_TSV;
+    char* trace_file = NULL; // JSON trace of the phases of every level, NULL = none
+    char* checkpoint_file = NULL; // state of the level-wise mining saved after every level, NULL = none
+    bool checkpoint_rows = false; // save the rows with the checkpoint, trimmed to the candidate items
+    int resume_level = 0; // level the checkpoint was saved before, 0 = mining from the start
+    vector<string> checkpoint_key; // dataset and mode the checkpoint is saved from
+    bool checkpointed = false; // the level-wise mining saved checkpoint_file, removed once the run is over
+    bool level_wise; // the dataset is mined level by level, loaded with its frequent items only
+    vector<string> candidates;
+    vector<string> single_candidates;
+    RunTrace trace;
+    double load_start;
+    vector< vector<string> > matrix;
+    map<string,float> dictionary;
+    int tot_lines;
+    int local_start = 0, local_end = 0;
+    string item;
+    string problem; // unknown flag or value, the run is refused
+
+    if(Policy::threads){
+        cout<<"Max threads: "<<Policy::max_threads()<<endl;
+    }
+
+    struct timeval start, end;
+    double elapsed = 0; // measured on rank 0
+
+    // optional flags after file name and min support
+    for(int i = 3; i < argc; i++){
+        if(strcmp(argv[i], "-fuse") == 0 && i+1 < argc){
+            fuse_threshold = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-fuse-depth") == 0 && i+1 < argc){
+            fuse_depth = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-hybrid") == 0 && i+1 < argc){
+            hybrid_budget = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-stream") == 0 && i+1 < argc){
+            stream_file = argv[++i];
+        }
+        else if(strcmp(argv[i], "-partition") == 0 && i+1 < argc){
+            partition_rows = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-sample") == 0 && i+1 < argc){
+            sample_fraction = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-sample-support") == 0 && i+1 < argc){
+            sample_support = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-state") == 0 && i+1 < argc){
+            state_file = argv[++i];
+        }
+        else if(strcmp(argv[i], "-delta") == 0 && i+1 < argc){
+            delta_file = argv[++i];
+        }
+        else if(strcmp(argv[i], "-save") == 0 && i+1 < argc){
+            save_file = argv[++i];
+        }
+        else if(strcmp(argv[i], "-lattice") == 0 && i+1 < argc){
+            lattice_file = argv[++i];
+        }
+        else if(strcmp(argv[i], "-topk") == 0 && i+1 < argc){
+            topk = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-maxlen") == 0 && i+1 < argc){
+            max_length = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-closed") == 0){
+            closed = true;
+        }
+        else if(strcmp(argv[i], "-shared") == 0){
+            shared = true;
+        }
+        else if(strcmp(argv[i], "-maximal") == 0){
+            maximal = true;
+        }
+        else if(strcmp(argv[i], "-rules") == 0){
+            rules = true;
+        }
+        else if(strcmp(argv[i], "-confidence") == 0 && i+1 < argc){
+            min_confidence = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-lift") == 0 && i+1 < argc){
+            min_lift = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-rules-out") == 0 && i+1 < argc){
+            rules_file = argv[++i];
+            rules = true;
+            if(rules_format == RULES_TEXT) rules_format = RULES_TSV;
+        }
+        else if(strcmp(argv[i], "-out") == 0 && i+1 < argc){
+            out_file = argv[++i];
+        }
+        else if(strcmp(argv[i], "-format") == 0 && i+1 < argc){
+            i++;
+            out_format = strcmp(argv[i], "bin") == 0 ? ITEMSETS_BINARY : strcmp(argv[i], "jsonl") == 0 ? ITEMSETS_JSONL : strcmp(argv[i], "tsv") == 0 ? ITEMSETS_TSV : -1;
+            if(out_format < 0){
+                problem = string("unknown format ") + argv[i];
+                break;
+            }
+        }
+        else if(strcmp(argv[i], "-trace") == 0 && i+1 < argc){
+            trace_file = argv[++i];
+        }
+        else if(strcmp(argv[i], "-checkpoint") == 0 && i+1 < argc){
+            checkpoint_file = argv[++i];
+        }
+        else if(strcmp(argv[i], "-checkpoint-rows") == 0){
+            checkpoint_rows = true;
+        }
+        else if(strcmp(argv[i], "-rules-format") == 0 && i+1 < argc){
+            i++;
+            rules_format = strcmp(argv[i], "bin") == 0 ? RULES_BINARY : strcmp(argv[i], "tsv") == 0 ? RULES_TSV : strcmp(argv[i], "text") == 0 ? RULES_TEXT : -1;
+            if(rules_format < 0){
+                problem = string("unknown rules format ") + argv[i];
+                break;
+            }
+        }
+        // also a flag given without its value
+        else{
+            problem = string("unknown flag ") + argv[i];
+            break;
+        }
+    }
+    if(!problem.empty()){
+        if(my_rank == 0){
+            cout<<problem<<endl;
+        }
+        Policy::finalize();
+        return 1;
+    }
+    if(sample_support < 0){
+        sample_support = 0.8*min_support;
+    }
+
+    // the input files must be readable before the ranks split them
+    for (int f = 0; f < 2; f++){
+        char* input = f == 0 ? file_name : delta_file;
+        string problem = input != NULL ? LineReader::check(input) : "";
+        if(!problem.empty()){
+            if(my_rank == 0){
+                cout<<problem<<endl;
+            }
+            Policy::finalize();
+            return 1;
+        }
+    }
+
+    // the files written after mining must be writable before it starts
+    char* outputs[] = {save_file, lattice_file, rules_file, out_file, trace_file, checkpoint_file};
+    for (size_t f = 0; f < sizeof(outputs)/sizeof(outputs[0]); f++){
+        problem = outputs[f] != NULL ? check_output(outputs[f]) : "";
+        if(!problem.empty()){
+            if(my_rank == 0){
+                cout<<problem<<endl;
+            }
+            Policy::finalize();
+            return 1;
+        }
+    }
+
+    // a state or a lattice holds every frequent itemset at min_support, which these modes do not produce
+    if((save_file != NULL || lattice_file != NULL) && (topk > 0 || closed || maximal)){
+        if(my_rank == 0){
+            cout<<(save_file != NULL ? "-save" : "-lattice")<<" cannot be used with -topk, -closed or -maximal"<<endl;
+        }
+        Policy::finalize();
+        return 1;
+    }
+    // the node-shared candidates are those of the level-wise mining of matrix, not of the other modes
+    if(shared && (stream_file != NULL || partition_rows > 0 || sample_fraction > 0 || state_file != NULL || delta_file != NULL ||
+                  topk > 0 || closed || maximal)){
+        if(my_rank == 0){
+            cout<<"-shared cannot be used with another mining mode"<<endl;
+        }
+        Policy::finalize();
+        return 1;
+    }
+    // the supports of the subsets of a closed or maximal itemset are not in the dictionary
+    if(rules && (closed || maximal)){
+        if(my_rank == 0){
+            cout<<"-rules cannot be used with -closed or -maximal"<<endl;
+        }
+        Policy::finalize();
+        return 1;
+    }
+
+    gettimeofday(&start, NULL);
+
+    if(delta_file != NULL && state_file != NULL){
+        // update the result saved in state_file with the rows of delta_file
+        tot_lines = fup_mining(file_name, delta_file, state_file, dictionary, min_support, my_rank, comm_sz);
+        if(tot_lines < 0){
+            Policy::finalize();
+            return 1;
+        }
+    }
+    else if(partition_rows > 0){
+        // two scans: local mining of every chunk, then a single counting scan of their union
+        tot_lines = partition_mining(file_name, partition_rows, dictionary, min_support, my_rank, comm_sz);
+    }
+    else if(stream_file != NULL){
+        // re-read the dataset at every level instead of keeping it in matrix
+        tot_lines = stream_mining(file_name, stream_file, dictionary, min_support, fuse_threshold, fuse_depth, my_rank, comm_sz);
+    }
+    else{
+        load_start = wall_time();
+        compute_local_start_end(file_name, my_rank, comm_sz, &local_start, &local_end);
+
+        // level-wise mining saved by a previous run with the same checkpoint: resume from its level
+        level_wise = !closed && !maximal && topk == 0 && sample_fraction == 0;
+        make_checkpoint_key(file_name, fuse_threshold, fuse_depth, hybrid_budget, checkpoint_key);
+        if(checkpoint_file != NULL && level_wise){
+            resume_level = read_checkpoint(checkpoint_file, file_name, local_start, local_end, matrix, dictionary, candidates, single_candidates, tot_lines, min_support, checkpoint_key, my_rank, comm_sz);
+        }
+        if(resume_level == 0 && level_wise){
+            // count the items first and prune level 1, so that the rows are stored with their frequent items only
+            tot_lines = load_frequent(file_name, local_start, local_end, matrix, dictionary, candidates, single_candidates, min_support, shared, my_rank, comm_sz, trace);
+        }
+        else if(resume_level == 0){
+            // read file into 2D vector matrix and insert 1-itemsets in dictionary as key with their frequency as value
+            read_file(file_name, local_start, local_end, matrix, dictionary);
+
+            // the slices of the ranks together hold every line, which are not counted again
+            tot_lines = Policy::sum_all((int)matrix.size());
+        }
+        trace.load_time = wall_time() - load_start;
+
+        if(resume_level > 0){
+            if(my_rank == 0){
+                cout<<"Resumed before level "<<resume_level<<endl;
+            }
+            mine_levels(matrix, dictionary, candidates, single_candidates, resume_level, tot_lines, min_support, 0, fuse_threshold, fuse_depth, hybrid_budget, shared, local_start, my_rank, comm_sz, checkpoint_file, checkpoint_rows, checkpoint_key, trace);
+            checkpointed = true;
+        }
+        else if(closed || maximal){
+            // depth-first on tid-lists, skipping the itemsets subsumed by a closed or maximal one
+            closed_mining(matrix, dictionary, tot_lines, min_support, maximal, local_start, my_rank, comm_sz);
+        }
+        else if(topk > 0){
+            // min_support is only a floor, raised to the support of the k-th most frequent itemset
+            topk_mining(matrix, dictionary, tot_lines, min_support, topk, max_length, my_rank, comm_sz);
+        }
+        else if(sample_fraction > 0){
+            // mine a sample, then count its frequent itemsets and their negative border on the whole dataset
+            sample_mining(matrix, dictionary, tot_lines, min_support, sample_fraction, sample_support, fuse_threshold, fuse_depth, hybrid_budget, my_rank, comm_sz);
+        }
+        else{
+            // insert in dictionary all k-itemset, starting from 2-itemset
+            mine_levels(matrix, dictionary, candidates, single_candidates, 2, tot_lines, min_support, 0, fuse_threshold, fuse_depth, hybrid_budget, shared, local_start, my_rank, comm_sz, checkpoint_file, checkpoint_rows, checkpoint_key, trace);
+            checkpointed = true;
+        }
+    }
+
+    if(my_rank == 0 && save_file != NULL){
+        save_state(save_file, dictionary, tot_lines, min_support);
+    }
+    if(my_rank == 0 && lattice_file != NULL){
+        write_lattice(lattice_file, dictionary, tot_lines, min_support);
+    }
+
+    if(my_rank == 0){
+        gettimeofday(&end, NULL);
+        elapsed = (end.tv_sec - start.tv_sec) + 
+                ((end.tv_usec - start.tv_usec)/1000000.0);
+        cout<<"Time passed: "<<elapsed<<endl;
+
+        if(out_file == NULL){
+            cout<<"KEY\tVALUE\n";
+            for (map<string, float>::iterator itr = dictionary.begin(); itr != dictionary.end(); ++itr) {
+                cout << itr->first << '\t' << itr->second << '\n';
+            }
+        }
+    }
+
+    if(trace_file != NULL){
+        write_trace(trace_file, trace, tot_lines, elapsed, my_rank, comm_sz);
+    }
+
+    if(out_file != NULL){
+        write_itemsets(dictionary, tot_lines, out_file, out_format, my_rank, comm_sz);
+    }
+
+    // print out all association rules with confidence >= min_confidence and lift >= min_lift
+    if(rules){
+        generate_association_rules(dictionary, tot_lines, min_confidence, min_lift, rules_file, rules_format, my_rank, comm_sz);
+    }
+
+    // the run is complete: a later one must not resume from its last level
+    if(my_rank == 0 && checkpointed && checkpoint_file != NULL){
+        remove(checkpoint_file);
+    }
+
+    Policy::finalize();
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Functions
+// ------------------------------------------------------------
+
+// level-wise mining of the rows in matrix: on entry dictionary holds the frequency of the 1-itemsets,
+// on exit every frequent itemset with its support. With a checkpoint_file the state is saved before every level,
+// with shared the candidates are generated by the node leaders only, once per node
+template <class Policy>
+void Apriori<Policy>::mine_matrix(vector< vector<string> > &matrix, map<string,float> &dictionary, int tot_lines, float min_support, int fuse_threshold, int fuse_depth, float hybrid_budget, bool shared, int local_start, int my_rank, int comm_sz, char checkpoint_file[], bool checkpoint_rows, vector<string> &checkpoint_key, RunTrace &trace){
+    vector<string> candidates;
+    vector<string> single_candidates;
+
+    prune_items(dictionary, candidates, single_candidates, min_support, tot_lines, shared, my_rank, comm_sz, trace);
+    trim_rows(matrix, single_candidates);
+
+    // insert in dictionary all k-itemset, starting from 2-itemset
+    mine_levels(matrix, dictionary, candidates, single_candidates, 2, tot_lines, min_support, 0, fuse_threshold, fuse_depth, hybrid_budget, shared, local_start, my_rank, comm_sz, checkpoint_file, checkpoint_rows, checkpoint_key, trace);
+}
+
+// pass-1 pruning, traced as level 1: prune from dictionary the 1-itemsets with support < min_support and insert
+// in candidates the 2-itemsets of the frequent ones, whose items are kept sorted in single_candidates
+template <class Policy>
+void Apriori<Policy>::prune_items(map<string,float> &dictionary, vector<string> &candidates, vector<string> &single_candidates, float min_support, int tot_lines, bool shared, int my_rank, int comm_sz, RunTrace &trace){
+    LevelTrace level;
+
+    level.k = 1;
+    level.candidates = dictionary.size();
+    if(shared){
+        share_candidates(dictionary, min_support, tot_lines, my_rank, comm_sz, candidates, single_candidates, level);
+    }
+    else{
+        prune_itemsets(dictionary, candidates, min_support, tot_lines, my_rank, comm_sz, single_candidates, level);
+    }
+    trace.levels.push_back(level);
+    sort(single_candidates.begin(), single_candidates.end());
+}
+
+// load the slice [local_start, local_end) of file_name for the level-wise mining in two passes: the items are
+// counted first, without storing the rows, and pruned by prune_items; the rows are then read with only the
+// items of the candidates of level 2, so that the infrequent items are never stored. Returns the rows of
+// the dataset
+template <class Policy>
+int Apriori<Policy>::load_frequent(char file_name[], int local_start, int local_end, vector< vector<string> > &matrix, map<string,float> &dictionary, vector<string> &candidates, vector<string> &single_candidates, float min_support, bool shared, int my_rank, int comm_sz, RunTrace &trace){
+    int tot_lines = Policy::sum_all(count_items(file_name, local_start, local_end, dictionary));
+
+    prune_items(dictionary, candidates, single_candidates, min_support, tot_lines, shared, my_rank, comm_sz, trace);
+    read_file(file_name, local_start, local_end, matrix, dictionary, &single_candidates);
+
+    return tot_lines;
+}
+
+// the levels from n of the level-wise mining, up to max_length (0 = any length), candidates holding those of
+// level n and dictionary, on rank 0, the frequent itemsets of the levels before. With shared only the node
+// leaders hold the candidates, counted by their node from one prefix tree in shared memory. matrix is released once its rows are coded as the ids of the
+// items of the candidates of level n, the only ones the following levels can hold, 16-bit when they fit
+template <class Policy>
+void Apriori<Policy>::mine_levels(vector< vector<string> > &matrix, map<string,float> &dictionary, vector<string> &candidates, vector<string> &single_candidates, int n, int tot_lines, float min_support, int max_length, int fuse_threshold, int fuse_depth, float hybrid_budget, bool shared, int local_start, int my_rank, int comm_sz, char checkpoint_file[], bool checkpoint_rows, vector<string> &checkpoint_key, RunTrace &trace){
+    vector<string> items(single_candidates);
+
+    sort(items.begin(), items.end());
+    if(items.size() <= NARROW_ITEMS){
+        mine_id_levels<uint16_t>(matrix, items, dictionary, candidates, single_candidates, n, tot_lines, min_support, max_length, fuse_threshold, fuse_depth, hybrid_budget, shared, local_start, my_rank, comm_sz, checkpoint_file, checkpoint_rows, checkpoint_key, trace);
+    }
+    else{
+        mine_id_levels<uint32_t>(matrix, items, dictionary, candidates, single_candidates, n, tot_lines, min_support, max_length, fuse_threshold, fuse_depth, hybrid_budget, shared, local_start, my_rank, comm_sz, checkpoint_file, checkpoint_rows, checkpoint_key, trace);
+    }
+}
+
+// mine_levels on the rows coded as ids of items: every level is counted matching the rows against a prefix
+// tree of its candidates, so that a row is never split into subsets that are not candidates
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::mine_id_levels(vector< vector<string> > &matrix, vector<string> &items, map<string,float> &dictionary, vector<string> &candidates, vector<string> &single_candidates, int n, int tot_lines, float min_support, int max_length, int fuse_threshold, int fuse_depth, float hybrid_budget, bool shared, int local_start, int my_rank, int comm_sz, char checkpoint_file[], bool checkpoint_rows, vector<string> &checkpoint_key, RunTrace &trace){
+    map<string,float> temp_dictionary;
+    vector<string> freq_itemsets;
+    vector< vector<Item> > rows;
+    vector<char> trie_buffer;
+    CandidateTrie<Item> trie;
+    vector<int> counts;
+    LevelTrace level;
+    double phase_start;
+    int n_candidates;
+
+    encode_rows(matrix, items, rows);
+    vector< vector<string> >().swap(matrix);
+
+    if(checkpoint_file != NULL){
+        write_checkpoint(checkpoint_file, rows, items, dictionary, candidates, single_candidates, n, tot_lines, min_support, checkpoint_rows, checkpoint_key, my_rank, comm_sz);
+    }
+
+    while(max_length == 0 || n <= max_length){
+        // with shared the other ranks have no candidates: the ones of rank 0 decide for every rank
+        n_candidates = candidates.size();
+        if(shared){
+            Policy::broadcast(n_candidates);
+        }
+        if(n_candidates == 0) break;
+
+        // continue depth-first on tid-lists once it fits the budget and the cost model prefers it
+        if(hybrid_budget > 0){
+            freq_itemsets.clear();
+            if(my_rank == 0){
+                level_itemsets(dictionary, n-1, freq_itemsets);
+            }
+            if(choose_depth_first(rows, items, n_candidates, single_candidates, dictionary, freq_itemsets, n, tot_lines, hybrid_budget, my_rank)){
+                if(my_rank == 0){
+                    cout<<"Depth-first from level "<<n<<endl;
+                }
+                Policy::broadcast_itemsets(freq_itemsets, my_rank);
+                phase_start = wall_time();
+                depth_first_mining(rows, items, single_candidates, freq_itemsets, dictionary, min_support, tot_lines, local_start, my_rank, comm_sz);
+                trace.depth_first_time = wall_time() - phase_start;
+                break;
+            }
+        }
+        // few candidates left: count this level and the following ones in a single scan and a single reduction
+        if(n_candidates < fuse_threshold){
+            phase_start = wall_time();
+            fused_pass(rows, items, candidates, single_candidates, dictionary, min_support, tot_lines, n, fuse_threshold, fuse_depth, shared, my_rank, comm_sz);
+            trace.fused_time += wall_time() - phase_start;
+            if(checkpoint_file != NULL){
+                write_checkpoint(checkpoint_file, rows, items, dictionary, candidates, single_candidates, n, tot_lines, min_support, checkpoint_rows, checkpoint_key, my_rank, comm_sz);
+            }
+            continue;
+        }
+        level = LevelTrace();
+        level.k = n;
+        level.candidates = n_candidates;
+        temp_dictionary.clear();
+        phase_start = wall_time();
+        // count the n-itemsets of every row that are candidates and insert them in temp_dictionary with their frequency
+        candidate_trie(candidates, items, shared, trie_buffer, trie);
+        count_trie(rows, trie, counts, level);
+        level.count_time = wall_time() - phase_start;
+        // every rank of a node counted the same tree: the node leader sums the counts and names the itemsets
+        phase_start = wall_time();
+        level.bytes_sent += Policy::sum_node_counts(counts);
+        trie_counts(trie, items, counts, 0, "", temp_dictionary);
+        level.reduce_time = wall_time() - phase_start;
+        // prune from temp_dictionary n-itemsets with support < min_support and insert items in candidates vector
+        if(shared){
+            share_candidates(temp_dictionary, min_support, tot_lines, my_rank, comm_sz, candidates, single_candidates, level);
+        }
+        else{
+            prune_itemsets(temp_dictionary, candidates, min_support, tot_lines, my_rank, comm_sz, single_candidates, level);
+        }
+        trace.levels.push_back(level);
+        // append new n-itemsets to main dictionary
+        if(my_rank == 0){
+            dictionary.insert(temp_dictionary.begin(), temp_dictionary.end());
+        }
+        n++;
+        if(checkpoint_file != NULL){
+            write_checkpoint(checkpoint_file, rows, items, dictionary, candidates, single_candidates, n, tot_lines, min_support, checkpoint_rows, checkpoint_key, my_rank, comm_sz);
+        }
+    }
+}
+
+// save the level-wise mining before level n to checkpoint_file: rank 0 writes the header, the frequent itemsets
+// found so far and the candidates of level n, then every rank the size and the rows of its slice trimmed to the
+// items of the candidates (none without with_rows), all ranks writing at the same time. The file is written as
+// <checkpoint_file>.tmp and renamed, so that a run killed while writing keeps the previous checkpoint
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::write_checkpoint(char checkpoint_file[], vector< vector<Item> > &rows, vector<string> &row_items, map<string,float> &dictionary, vector<string> &candidates, vector<string> &single_candidates, int n, int tot_lines, float min_support, bool with_rows, vector<string> &key, int my_rank, int comm_sz){
+    vector<char> buffer;
+    vector<char> row_strings;
+    vector<string> keys;
+    vector<float> supports;
+    set<string> items (single_candidates.begin(), single_candidates.end());
+    vector<string> row;
+    string temp_file = string(checkpoint_file) + ".tmp";
+    int header[4] = {n, tot_lines, comm_sz, with_rows};
+    long long size;
+
+    if(my_rank == 0){
+        for (map<string, float>::iterator i = dictionary.begin(); i != dictionary.end(); ++i) {
+            keys.push_back(i->first);
+            supports.push_back(i->second);
+        }
+        buffer.insert(buffer.end(), CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + 8);
+        buffer.insert(buffer.end(), (char*)header, (char*)header + sizeof(header));
+        buffer.insert(buffer.end(), (char*)&min_support, (char*)&min_support + sizeof(float));
+        append_strings(buffer, key);
+        append_strings(buffer, keys);
+        buffer.insert(buffer.end(), (char*)supports.data(), (char*)(supports.data() + supports.size()));
+        append_strings(buffer, candidates);
+        append_strings(buffer, single_candidates);
+    }
+
+    if(with_rows){
+        for (size_t i = 0; i < rows.size(); i++){
+            row.clear();
+            for (size_t j = 0; j < rows[i].size(); j++){
+                if(items.count(row_items[rows[i][j]]) > 0) row.push_back(row_items[rows[i][j]]);
+            }
+            append_strings(row_strings, row);
+        }
+    }
+    size = row_strings.size();
+    buffer.insert(buffer.end(), (char*)&size, (char*)&size + sizeof(long long));
+    buffer.insert(buffer.end(), row_strings.begin(), row_strings.end());
+
+    // a checkpoint that cannot be saved would leave the run unprotected without telling
+    if(!Policy::write_file(&temp_file[0], Policy::exclusive_sum((long long)buffer.size()), buffer)){
+        if(my_rank == 0){
+            cerr<<temp_file<<": cannot be written"<<endl;
+        }
+        Policy::abort();
+    }
+    if(my_rank == 0 && rename(temp_file.c_str(), checkpoint_file) != 0){
+        cerr<<checkpoint_file<<": cannot be written"<<endl;
+        Policy::abort();
+    }
+}
+
+// load the checkpoint written by write_checkpoint, returning the level it was saved before, or 0 if there is
+// none or it was saved at another min_support, or from another dataset or mode than key. The rows come from the checkpoint when it holds them for as
+// many ranks as now, otherwise from the slice [local_start, local_end) of file_name
+template <class Policy>
+int Apriori<Policy>::read_checkpoint(char checkpoint_file[], char file_name[], int local_start, int local_end, vector< vector<string> > &matrix, map<string,float> &dictionary, vector<string> &candidates, vector<string> &single_candidates, int &tot_lines, float min_support, vector<string> &key, int my_rank, int comm_sz){
+    ifstream checkpoint (checkpoint_file, ios::binary);
+    char magic[8];
+    int header[4]; // level, rows, ranks, with rows
+    float saved_support;
+    vector<string> saved_key;
+    vector<string> keys;
+    vector<float> supports;
+    map<string,float> item_counts; // not counted, the rows being read with their candidate items only
+    vector<string> items;
+    long long size;
+    long long rows_end;
+
+    checkpoint.read(magic, 8);
+    checkpoint.read((char*)header, sizeof(header));
+    checkpoint.read((char*)&saved_support, sizeof(float));
+    if(!checkpoint || memcmp(magic, CHECKPOINT_MAGIC, 8) != 0 || saved_support != min_support){
+        return 0;
+    }
+    read_strings(checkpoint, saved_key);
+    if(saved_key != key){
+        if(my_rank == 0){
+            cout<<checkpoint_file<<" was saved from another dataset or mode, mining from the start"<<endl;
+        }
+        return 0;
+    }
+    tot_lines = header[1];
+
+    read_strings(checkpoint, keys);
+    supports.resize(keys.size());
+    checkpoint.read((char*)supports.data(), supports.size()*sizeof(float));
+    if(my_rank == 0){
+        for (size_t i = 0; i < keys.size(); i++){
+            dictionary[keys[i]] = supports[i];
+        }
+    }
+    read_strings(checkpoint, candidates);
+    read_strings(checkpoint, single_candidates);
+
+    if(header[3] && header[2] == comm_sz){
+        // skip the rows of the ranks before this one
+        for (int r = 0; r < my_rank; r++){
+            checkpoint.read((char*)&size, sizeof(long long));
+            checkpoint.seekg(size, ios::cur);
+        }
+        checkpoint.read((char*)&size, sizeof(long long));
+        rows_end = (long long)checkpoint.tellg() + size;
+        while(checkpoint.tellg() < rows_end){
+            matrix.push_back(vector<string>());
+            read_strings(checkpoint, matrix.back());
+        }
+    }
+    else{
+        // trimmed as the rows saved with the checkpoint, to the items of the candidates
+        items = single_candidates;
+        sort(items.begin(), items.end());
+        read_file(file_name, local_start, local_end, matrix, item_counts, &items);
+    }
+
+    return header[0];
+}
+
+// what a checkpoint must have been saved from to be resumed: path, size and modification time of the dataset,
+// and the options that choose how the levels are mined
+template <class Policy>
+void Apriori<Policy>::make_checkpoint_key(char file_name[], int fuse_threshold, int fuse_depth, float hybrid_budget, vector<string> &key){
+    struct stat info;
+    stringstream mode;
+
+    key.clear();
+    key.push_back(file_name);
+    if(stat(file_name, &info) == 0){
+        key.push_back(to_string((long long)info.st_size));
+        key.push_back(to_string((long long)info.st_mtim.tv_sec) + "." + to_string((long long)info.st_mtim.tv_nsec));
+    }
+    mode << "level-wise fuse " << fuse_threshold << " " << fuse_depth << " hybrid " << hybrid_budget;
+    key.push_back(mode.str());
+}
+
+// append the number of strings, then the length and the bytes of each
+template <class Policy>
+void Apriori<Policy>::append_strings(vector<char> &buffer, vector<string> &strings){
+    int size = strings.size();
+
+    buffer.insert(buffer.end(), (char*)&size, (char*)&size + sizeof(int));
+    for (size_t i = 0; i < strings.size(); i++){
+        size = strings[i].size();
+        buffer.insert(buffer.end(), (char*)&size, (char*)&size + sizeof(int));
+        buffer.insert(buffer.end(), strings[i].begin(), strings[i].end());
+    }
+}
+
+template <class Policy>
+void Apriori<Policy>::read_strings(ifstream &in, vector<string> &strings){
+    int n_strings = 0;
+    int size;
+
+    in.read((char*)&n_strings, sizeof(int));
+    strings.resize(n_strings);
+    for (int i = 0; i < n_strings && in; i++){
+        in.read((char*)&size, sizeof(int));
+        strings[i].resize(size);
+        in.read(&strings[i][0], size);
+    }
+}
+
+// stop the run if myfile, read from file_name, could not be read whole: what was read would be mined as if it
+// were the dataset
+template <class Policy>
+void Apriori<Policy>::check_input(LineReader &myfile, char file_name[]){
+    if(myfile.failed()){
+        cerr<<file_name<<": cannot be read, or corrupt or truncated gzip input"<<endl;
+        Policy::abort();
+    }
+}
+
+// why file cannot be written, or an empty string: an existing file must be writable, a new one needs a writable
+// directory. Checked before mining, without creating anything, so that a wrong path does not cost the run
+template <class Policy>
+string Apriori<Policy>::check_output(char file[]){
+    struct stat info;
+    string directory (file);
+
+    if(stat(file, &info) == 0){
+        if(S_ISDIR(info.st_mode)) return string(file) + ": is a directory";
+        if(access(file, W_OK) != 0) return string(file) + ": cannot be written";
+        return "";
+    }
+    directory = directory.rfind('/') == string::npos ? "." : directory.substr(0, directory.rfind('/') + 1);
+    if(access(directory.c_str(), W_OK | X_OK) != 0){
+        return string(file) + ": cannot be created";
+    }
+    return "";
+}
+
+template <class Policy>
+int Apriori<Policy>::count_file_lines(char file_name[]){
+    int tot_lines = 0;
+    string line;
+    LineReader myfile (file_name);
+
+    while(getline (myfile, line)){
+        tot_lines++;
+    }
+
+    check_input(myfile, file_name);
+    myfile.close();
+
+    return tot_lines;
+}
+
+template <class Policy>
+void Apriori<Policy>::compute_local_start_end(char file_name[], int my_rank, int comm_sz, int *local_start, int *local_end){
+    // a single process takes every line, however many
+    if(!Policy::distributed){
+        *local_start = 0;
+        *local_end = INT_MAX;
+        return;
+    }
+    compute_local_range(count_file_lines(file_name), my_rank, comm_sz, local_start, local_end);
+}
+
+// split tot_lines rows among comm_sz ranks, the sizes of the slices differ by one at most
+template <class Policy>
+void Apriori<Policy>::compute_local_range(int tot_lines, int my_rank, int comm_sz, int *local_start, int *local_end){
+    int lines_per_each;
+    *local_start = 0;
+    *local_end = 0;
+
+    // https://www.geeksforgeeks.org/split-the-number-into-n-parts-such-that-difference-between-the-smallest-and-the-largest-part-is-minimum/
+    lines_per_each = tot_lines/comm_sz;
+
+    if(tot_lines%comm_sz != 0){
+        int zp = comm_sz - (tot_lines % comm_sz);
+        for(int i=0; i<my_rank; i++){
+            if(i >= zp){
+                *local_start += lines_per_each + 1;
+            }
+            else{
+                *local_start += lines_per_each;
+            }
+        }
+        if(my_rank >= zp){
+            lines_per_each++;
+        }
+        *local_end = *local_start + lines_per_each;
+    }
+    else{
+        *local_start = lines_per_each*my_rank;
+        *local_end = *local_start + lines_per_each;
+    }
+}
+
+// read the lines from local_start to local_end of file_name into matrix, counting the 1-itemsets in dictionary.
+// The loading is a pipeline: one thread reads the lines (a gzip file being decompressed by the threads of its
+// LineReader) and hands them out in batches of LOAD_BATCH_ROWS, while the other threads parse, sort and count
+// the batches already read. The rows of every batch keep their place, so matrix follows the order of the file
+template <class Policy>
+void Apriori<Policy>::read_file(char file_name[], int local_start, int local_end, vector< vector<string> > &matrix, map<string,float> &dictionary){
+    read_file(file_name, local_start, local_end, matrix, dictionary, NULL);
+}
+
+// read_file keeping in the rows only the items in items (sorted), as trim_rows does, when it is not NULL:
+// the items are then already counted and dictionary is left as it is
+template <class Policy>
+void Apriori<Policy>::read_file(char file_name[], int local_start, int local_end, vector< vector<string> > &matrix, map<string,float> &dictionary, const vector<string>* items){
+    int line_index = 0;
+    LineReader myfile (file_name);
+    deque< vector< vector<string> > > batches; // rows of every batch, in file order
+    vector< map<string,float> > thread_counts(Policy::max_threads());
+    size_t n_rows = 0;
+
+    #pragma omp parallel
+    #pragma omp single
+    {
+        vector<string>* lines = new vector<string>;
+        string line;
+
+        while(line_index < local_end && getline (myfile, line)){
+            if(line_index++ < local_start) continue;
+
+            lines->push_back(line);
+            if(lines->size() == LOAD_BATCH_ROWS){
+                batches.push_back(vector< vector<string> >());
+                vector< vector<string> >* rows = &batches.back();
+
+                #pragma omp task firstprivate(lines, rows)
+                {
+                    parse_rows(*lines, *rows, thread_counts[Policy::thread_num()], items);
+                    delete lines;
+                }
+                lines = new vector<string>;
+            }
+        }
+        if(!lines->empty()){
+            batches.push_back(vector< vector<string> >());
+            parse_rows(*lines, batches.back(), thread_counts[Policy::thread_num()], items);
+        }
+        delete lines;
+    }
+
+    check_input(myfile, file_name);
+    myfile.close();
+
+    // insert the 1-itemsets into dictionary with the sum of their frequencies over the threads
+    for (size_t t = 0; t < thread_counts.size(); t++){
+        for (map<string, float>::iterator i = thread_counts[t].begin(); i != thread_counts[t].end(); ++i) {
+            dictionary[i->first] += i->second;
+        }
+    }
+
+    for (size_t b = 0; b < batches.size(); b++){
+        n_rows += batches[b].size();
+    }
+    matrix.reserve(matrix.size() + n_rows);
+    while(!batches.empty()){
+        for (size_t i = 0; i < batches.front().size(); i++){
+            matrix.push_back(vector<string>());
+            matrix.back().swap(batches.front()[i]);
+        }
+        batches.pop_front();
+    }
+}
+
+// split every line of lines into its items, sorted, as a row of rows, counting the items in counts. With items
+// only the items in it are kept, without counting, and the rows left with less than two are dropped
+template <class Policy>
+void Apriori<Policy>::parse_rows(vector<string> &lines, vector< vector<string> > &rows, map<string,float> &counts, const vector<string>* items){
+    vector<string> row;
+    stringstream ss;
+    string item;
+
+    rows.reserve(lines.size());
+    for (size_t l = 0; l < lines.size(); l++){
+        ss << lines[l];
+
+        while(getline (ss, item, ' ')) {
+            item.erase(remove(item.begin(), item.end(), '\r'), item.end());
+            if(items != NULL){
+                if(binary_search(items->begin(), items->end(), item)) row.push_back(item);
+                continue;
+            }
+            row.push_back(item);
+            // insert item into counts and increment its value
+            counts[item]++;
+        }
+
+        sort(row.begin(), row.end());
+        if(items == NULL || row.size() >= 2){
+            rows.push_back(row);
+        }
+
+        ss.clear();
+        row.clear();
+    }
+}
+
+// pass-1 pruning of the rows: keep only the items of the 2-itemset candidates (items, sorted), the only ones a
+// candidate of the next levels can contain, and drop the rows left with less than two items
+template <class Policy>
+void Apriori<Policy>::trim_rows(vector< vector<string> > &matrix, const vector<string> &items){
+    int kept = 0;
+
+    #pragma omp parallel for
+    for (size_t i = 0; i < matrix.size(); i++){
+        vector<string> row;
+
+        for (size_t j = 0; j < matrix[i].size(); j++){
+            if(binary_search(items.begin(), items.end(), matrix[i][j])){
+                row.push_back(string());
+                row.back().swap(matrix[i][j]);
+            }
+        }
+        matrix[i].swap(row);
+    }
+
+    for (size_t i = 0; i < matrix.size(); i++){
+        if(matrix[i].size() >= 2){
+            matrix[kept++].swap(matrix[i]);
+        }
+    }
+    matrix.resize(kept);
+    matrix.shrink_to_fit();
+}
+
+// divide the frequencies in dictionary by tot_lines; threads take every i-th itemset of the map, which a
+// single thread walks in order instead
+template <class Policy>
+void Apriori<Policy>::normalise(map<string,float> &dictionary, int tot_lines){
+    if(!Policy::threads){
+        for (map<string, float>::iterator i = dictionary.begin(); i != dictionary.end(); ++i) {
+            i->second = i->second/float(tot_lines);
+        }
+        return;
+    }
+
+    #pragma omp parallel for
+    for (size_t i=0; i<dictionary.size(); i++) {
+        map<string, float>::iterator itr = dictionary.begin();
+        advance(itr, i);
+        itr->second = itr->second/float(tot_lines);
+    }
+}
+
+// count in counts the candidates, of any length, contained in each of rows, on the ids of the items of the
+// candidates, 16-bit when they fit
+template <class Policy>
+void Apriori<Policy>::count_itemsets(vector< vector<string> > &rows, vector<string> &candidates, map<string,float> &counts){
+    set<string> item_set;
+    stringstream ss;
+    string item;
+
+    for (size_t i = 0; i < candidates.size(); i++){
+        ss << candidates[i];
+        while(getline (ss, item, ' ')) {
+            item_set.insert(item);
+        }
+        ss.clear();
+    }
+    vector<string> items(item_set.begin(), item_set.end());
+
+    if(items.size() <= NARROW_ITEMS){
+        count_ids<uint16_t>(rows, candidates, items, counts);
+    }
+    else{
+        count_ids<uint32_t>(rows, candidates, items, counts);
+    }
+}
+
+// count_itemsets on the ids of items (sorted)
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::count_ids(vector< vector<string> > &rows, vector<string> &candidates, vector<string> &items, map<string,float> &counts){
+    vector< vector<Item> > id_rows;
+    vector<char> trie_buffer;
+    CandidateTrie<Item> trie;
+    vector<int> node_counts;
+    LevelTrace level;
+
+    build_trie<Item>(candidates, items, trie_buffer);
+    trie.view(trie_buffer.data());
+    encode_rows(rows, items, id_rows);
+    count_trie(id_rows, trie, node_counts, level);
+    trie_counts(trie, items, node_counts, 0, "", counts);
+}
+
+// the items of every row of matrix that are in items (sorted) as their ids, in rows sorted as the items
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::encode_rows(vector< vector<string> > &matrix, vector<string> &items, vector< vector<Item> > &rows){
+    rows.assign(matrix.size(), vector<Item>());
+
+    #pragma omp parallel for
+    for (size_t i = 0; i < matrix.size(); i++){
+        for (size_t j = 0; j < matrix[i].size(); j++){
+            vector<string>::iterator itr = lower_bound(items.begin(), items.end(), matrix[i][j]);
+            if(itr != items.end() && *itr == matrix[i][j]) rows[i].push_back(itr - items.begin());
+        }
+        sort(rows[i].begin(), rows[i].end());
+    }
+}
+
+// view in trie the CandidateTrie of candidates, built into buffer. With shared it is built by the node leaders
+// only and read by the other ranks of each node from the copy of their leader in shared memory
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::candidate_trie(vector<string> &candidates, vector<string> &items, bool shared, vector<char> &buffer, CandidateTrie<Item> &trie){
+    if(!shared){
+        build_trie<Item>(candidates, items, buffer);
+        trie.view(buffer.data());
+        return;
+    }
+    buffer.clear();
+    if(Policy::node_leader()){
+        build_trie<Item>(candidates, items, buffer);
+    }
+    trie.view(Policy::share_buffer(buffer));
+}
+
+// pack into buffer the CandidateTrie of candidates, itemsets of any length: the items of each are coded as their
+// ids in items (sorted) and sorted, the duplicates are dropped with the candidates holding an item outside items,
+// which no row coded on items can contain. The nodes are added one depth at a time, each itemset remembering
+// the node of its prefix
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::build_trie(vector<string> &candidates, vector<string> &items, vector<char> &buffer){
+    vector< vector<Item> > itemsets;
+    vector<Item> itemset;
+    vector<int> parents;
+    vector<int> first(1, -1);
+    vector<Item> node_items(1, 0);
+    vector<char> ends(1, 0);
+    stringstream ss;
+    string item;
+    size_t depth = 0;
+    bool known;
+    int last_parent;
+
+    for (size_t i = 0; i < candidates.size(); i++){
+        itemset.clear();
+        known = true;
+        ss << candidates[i];
+        while(getline (ss, item, ' ')) {
+            vector<string>::iterator itr = lower_bound(items.begin(), items.end(), item);
+            if(itr == items.end() || *itr != item) known = false;
+            else itemset.push_back(itr - items.begin());
+        }
+        ss.clear();
+
+        if(known && !itemset.empty()){
+            sort(itemset.begin(), itemset.end());
+            itemsets.push_back(itemset);
+            depth = max(depth, itemset.size());
+        }
+    }
+    sort(itemsets.begin(), itemsets.end());
+    itemsets.erase(unique(itemsets.begin(), itemsets.end()), itemsets.end());
+
+    // the itemsets sharing a prefix are next to each other: a node for each run of them at every depth
+    parents.assign(itemsets.size(), 0);
+    for (size_t d = 0; d < depth; d++){
+        last_parent = -1;
+        for (size_t i = 0; i < itemsets.size(); i++){
+            if(itemsets[i].size() <= d) continue;
+
+            if(parents[i] != last_parent || itemsets[i][d] != node_items.back()){
+                if(first[parents[i]] < 0) first[parents[i]] = node_items.size();
+                last_parent = parents[i];
+                node_items.push_back(itemsets[i][d]);
+                first.push_back(-1);
+                ends.push_back(0);
+            }
+            parents[i] = node_items.size() - 1;
+            if(itemsets[i].size() == d+1) ends.back() = 1;
+        }
+    }
+
+    // a node without children starts them where the next node does
+    first.push_back(node_items.size());
+    for (int i = node_items.size() - 1; i >= 0; i--){
+        if(first[i] < 0) first[i] = first[i+1];
+    }
+
+    buffer.resize(CandidateTrie<Item>::packed_size(node_items.size()));
+    CandidateTrie<Item>::pack(first, node_items, ends, buffer.data());
+}
+
+// count in counts, by node, the candidates of trie contained in every row, recording the time and the hardware
+// counters of every thread in level
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::count_trie(vector< vector<Item> > &rows, CandidateTrie<Item> &trie, vector<int> &counts, LevelTrace &level){
+    vector< vector<int> > thread_counts(Policy::max_threads()); // thread 0 counts into counts
+
+    counts.assign(trie.n_nodes, 0);
+    level.thread_times.resize(Policy::max_threads());
+    level.thread_events.resize(Policy::max_threads());
+    #pragma omp parallel
+    {
+        double thread_start = wall_time();
+        vector<int> perf_fds;
+        int thread = Policy::thread_num();
+        vector<int> &local_counts = thread == 0 ? counts : thread_counts[thread];
+
+        local_counts.resize(trie.n_nodes, 0);
+        perf_start(perf_fds);
+        #pragma omp for nowait
+        for (size_t i = 0; i < rows.size(); i++){
+            count_row(rows[i], 0, 0, trie, local_counts);
+        }
+        perf_stop(perf_fds, level.thread_events[thread]);
+        level.thread_times[thread] = wall_time() - thread_start;
+    }
+    perf_sum(level.thread_events, level.count_events);
+
+    // the counts of the other threads merged once, each node summed by one thread
+    #pragma omp parallel for
+    for (int c = 0; c < trie.n_nodes; c++){
+        for (size_t t = 1; t < thread_counts.size(); t++){
+            if(!thread_counts[t].empty()) counts[c] += thread_counts[t][c];
+        }
+    }
+}
+
+// count the candidates below node contained in row from pos on, in the counts of the calling thread: the items
+// of row and the children of node are both sorted, so each item is searched only among the children after the
+// last one found
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::count_row(vector<Item> &row, size_t pos, int node, CandidateTrie<Item> &trie, vector<int> &counts){
+    const Item* child = trie.items + trie.first[node];
+    const Item* last = trie.items + trie.first[node+1];
+    int c;
+
+    for (size_t j = pos; j < row.size() && child < last; j++){
+        child = lower_bound(child, last, row[j]);
+        if(child == last) break;
+        if(*child != row[j]) continue;
+
+        c = child - trie.items;
+        if(trie.ends[c]){
+            counts[c]++;
+        }
+        if(trie.first[c] < trie.first[c+1]){
+            count_row(row, j+1, c, trie, counts);
+        }
+        child++;
+    }
+}
+
+// add to dictionary the candidates below node counted in at least one row, named as their items in items
+// preceded by itemset
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::trie_counts(CandidateTrie<Item> &trie, vector<string> &items, vector<int> &counts, int node, string itemset, map<string,float> &dictionary){
+    string name;
+
+    for (int c = trie.first[node]; c < trie.first[node+1]; c++){
+        name = node == 0 ? items[trie.items[c]] : itemset + " " + items[trie.items[c]];
+        if(trie.ends[c] && counts[c] > 0){
+            dictionary[name] += counts[c];
+        }
+        trie_counts(trie, items, counts, c, name, dictionary);
+    }
+}
+
+template <class Policy>
+void Apriori<Policy>::prune_itemsets(map<string,float> &temp_dictionary, vector<string> &candidates, float min_support, int tot_lines, int my_rank, int comm_sz, vector<string> &single_candidates){
+    LevelTrace level;
+
+    prune_itemsets(temp_dictionary, candidates, min_support, tot_lines, my_rank, comm_sz, single_candidates, level);
+}
+
+// prune_itemsets recording the time of every phase and the bytes sent in level
+template <class Policy>
+void Apriori<Policy>::prune_itemsets(map<string,float> &temp_dictionary, vector<string> &candidates, float min_support, int tot_lines, int my_rank, int comm_sz, vector<string> &single_candidates, LevelTrace &level){
+    vector<string> freq_itemsets;
+    double phase_start;
+    vector<int> perf_fds;
+
+    reduce_itemsets(temp_dictionary, min_support, tot_lines, my_rank, comm_sz, freq_itemsets, level);
+
+    phase_start = wall_time();
+    perf_start(perf_fds);
+    candidates.clear(); // empty candidates to then update it
+    single_candidates.clear();
+
+    if(!freq_itemsets.empty()){
+        update_candidates(candidates, freq_itemsets, single_candidates);
+    }
+    perf_stop(perf_fds, level.generation_events);
+    level.generation_time = wall_time() - phase_start;
+}
+
+// sum the itemsets counted by every rank on rank 0, prune them and send the frequent ones back to all ranks
+template <class Policy>
+void Apriori<Policy>::reduce_itemsets(map<string,float> &temp_dictionary, float min_support, int tot_lines, int my_rank, int comm_sz, vector<string> &freq_itemsets){
+    LevelTrace level;
+
+    reduce_itemsets(temp_dictionary, min_support, tot_lines, my_rank, comm_sz, freq_itemsets, level);
+}
+
+// reduce_itemsets recording the time of the reduction, the pruning and the broadcast in level
+template <class Policy>
+void Apriori<Policy>::reduce_itemsets(map<string,float> &temp_dictionary, float min_support, int tot_lines, int my_rank, int comm_sz, vector<string> &freq_itemsets, LevelTrace &level){
+    double phase_start;
+
+    collect_frequent(temp_dictionary, min_support, tot_lines, my_rank, comm_sz, freq_itemsets, level);
+
+    phase_start = wall_time();
+    level.bytes_sent += Policy::broadcast_itemsets(freq_itemsets, my_rank);
+    level.broadcast_time = wall_time() - phase_start;
+    level.frequent = freq_itemsets.size();
+}
+
+// sum the counts of every rank on rank 0, divide them once by tot_lines and keep the frequent itemsets, in
+// freq_itemsets of rank 0: the supports do not depend on how the rows are split
+template <class Policy>
+void Apriori<Policy>::collect_frequent(map<string,float> &temp_dictionary, float min_support, int tot_lines, int my_rank, int comm_sz, vector<string> &freq_itemsets, LevelTrace &level){
+    double phase_start = wall_time();
+
+    level.bytes_sent += Policy::collect_itemsets(temp_dictionary, my_rank, comm_sz);
+    level.reduce_time += wall_time() - phase_start;
+
+    phase_start = wall_time();
+    if(my_rank == 0){
+        // divide frequency by number of rows to calculate support
+        normalise(temp_dictionary, tot_lines);
+    }
+    level.normalise_time = wall_time() - phase_start;
+
+    phase_start = wall_time();
+    if(my_rank == 0){
+        // prune itemsets to obtain just frequent ones
+        for (map<string, float>::iterator it = temp_dictionary.begin(); it != temp_dictionary.end(); ){ // like a while
+            if (it->second < min_support){
+                temp_dictionary.erase(it++);
+            }
+            else{
+                freq_itemsets.push_back(it->first);
+                ++it;
+            }
+        }
+    }
+    level.prune_time = wall_time() - phase_start;
+}
+
+template <class Policy>
+void Apriori<Policy>::update_candidates(vector<string> &candidates, vector<string> freq_itemsets, vector<string> &single_candidates){
+    string item;
+    stringstream to_combine;
+    vector<string> items;
+    vector<string> elements;
+    string combination;
+
+    int common_items;
+
+    #pragma omp parallel for private(item, to_combine, items, elements, combination, common_items)
+    for(size_t i = 0; i < freq_itemsets.size()-1; i++){
+        for(size_t j = i+1; j < freq_itemsets.size(); j++){
+            common_items = 0;
+            items.clear();
+            to_combine.clear();
+            combination.clear();
+
+            to_combine << freq_itemsets[i] + ' ' + freq_itemsets[j];
+            while(getline (to_combine, item, ' ')) {
+                if(!(find(items.begin(), items.end(), item) != items.end())){
+                    items.push_back(item);
+                    combination += " " + item;
+                }
+                else{
+                    common_items++;
+                }
+            }
+
+            // if the statement is true than we can add combination as candidate
+            // else we created all correct combinations and we pass to the next itemset
+            if(common_items == (int)items.size()-2){
+                combination.erase(0,1); // remove first space
+
+                #pragma omp critical
+                {   
+                    candidates.push_back(combination);
+                    
+                    // insert single items candidates
+                    for(size_t i=0; i<items.size(); i++) {
+                        if(!(find(single_candidates.begin(), single_candidates.end(), items[i]) != single_candidates.end())){
+                            single_candidates.push_back(items[i]);
+                        }
+                    }
+                    
+                }
+            }
+            else{
+                break;
+            }
+
+        }
+    }
+}
+
+// prune_itemsets for -shared: the frequent itemsets go to the node leaders only, which generate the candidates
+// of the next level, the other ranks being left without. Every rank gets the items of the candidates of rank 0
+template <class Policy>
+void Apriori<Policy>::share_candidates(map<string,float> &temp_dictionary, float min_support, int tot_lines, int my_rank, int comm_sz, vector<string> &candidates, vector<string> &single_candidates, LevelTrace &level){
+    vector<string> freq_itemsets;
+    double phase_start;
+    vector<int> perf_fds;
+
+    collect_frequent(temp_dictionary, min_support, tot_lines, my_rank, comm_sz, freq_itemsets, level);
+
+    phase_start = wall_time();
+    level.bytes_sent += Policy::broadcast_leaders(freq_itemsets, my_rank);
+    level.broadcast_time = wall_time() - phase_start;
+    level.frequent = freq_itemsets.size();
+
+    phase_start = wall_time();
+    perf_start(perf_fds);
+    candidates.clear();
+    single_candidates.clear();
+    if(!freq_itemsets.empty()){
+        update_candidates(candidates, freq_itemsets, single_candidates);
+    }
+    perf_stop(perf_fds, level.generation_events);
+    level.generation_time = wall_time() - phase_start;
+
+    share_singles(single_candidates, my_rank, level);
+}
+
+// the items of the candidates of rank 0 on every rank, which trims and codes its rows with them
+template <class Policy>
+void Apriori<Policy>::share_singles(vector<string> &single_candidates, int my_rank, LevelTrace &level){
+    double phase_start = wall_time();
+
+    if(my_rank != 0){
+        single_candidates.clear();
+    }
+    level.bytes_sent += Policy::broadcast_itemsets(single_candidates, my_rank);
+    level.broadcast_time += wall_time() - phase_start;
+}
+
+// speculatively generate the candidates of the next levels from the current ones, as if every candidate
+// were frequent: a frequent itemset is always the join of two frequent ones, so none of them is missed
+template <class Policy>
+void Apriori<Policy>::speculate_levels(vector<string> &candidates, vector<string> &single_candidates, int fuse_threshold, int fuse_depth, vector< vector<string> > &levels, vector< vector<string> > &level_singles){
+    vector<string> next;
+    vector<string> next_singles;
+    set<string> sorted_candidates;
+
+    levels.push_back(candidates);
+    level_singles.push_back(single_candidates);
+
+    while(fuse_depth == 0 || (int)levels.size() < fuse_depth){
+        // update_candidates expects itemsets in the sorted order of the dictionary keys
+        sorted_candidates.clear();
+        sorted_candidates.insert(levels.back().begin(), levels.back().end());
+        if(sorted_candidates.size() < 2) break;
+
+        next.clear();
+        next_singles.clear();
+        update_candidates(next, vector<string>(sorted_candidates.begin(), sorted_candidates.end()), next_singles);
+
+        // remove duplicates, stop speculating once a level gets as large as a normal one
+        sorted_candidates.clear();
+        sorted_candidates.insert(next.begin(), next.end());
+        if(sorted_candidates.empty() || (int)sorted_candidates.size() >= fuse_threshold) break;
+
+        levels.push_back(vector<string>(sorted_candidates.begin(), sorted_candidates.end()));
+        level_singles.push_back(next_singles);
+    }
+}
+
+// count level n and the speculated following levels in one scan of rows, on a single prefix tree holding the
+// candidates of all of them, then reduce all of them
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::fused_pass(vector< vector<Item> > &rows, vector<string> &row_items, vector<string> &candidates, vector<string> &single_candidates, map<string,float> &dictionary, float min_support, int tot_lines, int &n, int fuse_threshold, int fuse_depth, bool shared, int my_rank, int comm_sz){
+    vector< vector<string> > levels;
+    vector< vector<string> > level_singles;
+    vector<string> fused_candidates;
+    map<string,float> fused_dictionary; // itemsets of different levels never share a key
+    vector<char> trie_buffer;
+    CandidateTrie<Item> trie;
+    vector<int> counts;
+    LevelTrace level;
+    int n_levels;
+
+    speculate_levels(candidates, single_candidates, fuse_threshold, fuse_depth, levels, level_singles);
+    for (size_t l = 0; l < levels.size(); l++){
+        fused_candidates.insert(fused_candidates.end(), levels[l].begin(), levels[l].end());
+    }
+    // with shared only the node leaders speculate, as the others have no candidates
+    n_levels = levels.size();
+    if(shared){
+        Policy::broadcast(n_levels);
+    }
+
+    candidate_trie(fused_candidates, row_items, shared, trie_buffer, trie);
+    count_trie(rows, trie, counts, level);
+    Policy::sum_node_counts(counts);
+    trie_counts(trie, row_items, counts, 0, "", fused_dictionary);
+
+    reduce_levels(fused_dictionary, n_levels, candidates, single_candidates, dictionary, min_support, tot_lines, n, shared, my_rank, comm_sz);
+}
+
+// sum, normalise and prune the n_levels levels counted in fused_dictionary in a single round and
+// rebuild the real candidates level by level from the frequent itemsets, on the node leaders only with shared
+template <class Policy>
+void Apriori<Policy>::reduce_levels(map<string,float> &fused_dictionary, int n_levels, vector<string> &candidates, vector<string> &single_candidates, map<string,float> &dictionary, float min_support, int tot_lines, int &n, bool shared, int my_rank, int comm_sz){
+    vector<string> freq_itemsets;
+    LevelTrace level;
+
+    if(shared){
+        collect_frequent(fused_dictionary, min_support, tot_lines, my_rank, comm_sz, freq_itemsets, level);
+        Policy::broadcast_leaders(freq_itemsets, my_rank);
+    }
+    else{
+        reduce_itemsets(fused_dictionary, min_support, tot_lines, my_rank, comm_sz, freq_itemsets);
+    }
+
+    if(my_rank == 0){
+        dictionary.insert(fused_dictionary.begin(), fused_dictionary.end());
+    }
+
+    // split the frequent itemsets by level, keeping their sorted order
+    vector< vector<string> > level_freq(n_levels);
+    for(size_t i=0; i<freq_itemsets.size(); i++){
+        level_freq[count(freq_itemsets[i].begin(), freq_itemsets[i].end(), ' ') + 1 - n].push_back(freq_itemsets[i]);
+    }
+
+    for (int l = 0; l < n_levels; l++){
+        candidates.clear();
+        single_candidates.clear();
+        n++;
+
+        if(level_freq[l].empty()) break;
+        update_candidates(candidates, level_freq[l], single_candidates);
+    }
+    // the other ranks, without frequent itemsets, stopped at the first level
+    if(shared){
+        Policy::broadcast(n);
+        share_singles(single_candidates, my_rank, level);
+    }
+}
+
+// collect the (sorted) keys of dictionary with k items
+template <class Policy>
+void Apriori<Policy>::level_itemsets(map<string,float> &dictionary, int k, vector<string> &itemsets){
+    itemsets.clear();
+    for (map<string, float>::iterator i = dictionary.begin(); i != dictionary.end(); ++i) {
+        if(count(i->first.begin(), i->first.end(), ' ') == k-1){
+            itemsets.push_back(i->first);
+        }
+    }
+}
+
+// cost model of the hybrid engine: the next breadth-first level enumerates every n-subset of the trimmed
+// rows and looks it up among the candidates, while the depth-first continuation intersects the tid-list
+// of each frequent (n-1)-itemset with the ones of its class; rank 0 decides when that is cheaper and fits the budget
+template <class Policy>
+template <class Item>
+bool Apriori<Policy>::choose_depth_first(vector< vector<Item> > &rows, vector<string> &row_items, int n_candidates, vector<string> &single_candidates, map<string,float> &dictionary, vector<string> &freq_itemsets, int n, int tot_lines, float hybrid_budget, int my_rank){
+    double trimmed_size = 0;
+    double bfs_cost = 0;
+    double dfs_cost = 0;
+    double tids_size = 0;
+    double subsets;
+    int trimmed_items;
+    int depth_first = 0;
+    double local_costs[2];
+    double costs[2];
+
+    // only the items of the candidates can be extended further
+    vector<char> extendable(row_items.size(), 0);
+    for (size_t i = 0; i < single_candidates.size(); i++){
+        extendable[lower_bound(row_items.begin(), row_items.end(), single_candidates[i]) - row_items.begin()] = 1;
+    }
+
+    #pragma omp parallel for private(trimmed_items, subsets) reduction(+:trimmed_size, bfs_cost)
+    for (size_t i = 0; i < rows.size(); i++){
+        trimmed_items = 0;
+        for (size_t j = 0; j < rows[i].size(); j++){
+            trimmed_items += extendable[rows[i][j]];
+        }
+        trimmed_size += trimmed_items;
+
+        // binomial(trimmed_items, n)
+        subsets = 1;
+        for (int j = 0; j < n && subsets > 0; j++){
+            subsets = subsets*(trimmed_items-j)/(j+1);
+        }
+        bfs_cost += subsets*n_candidates;
+    }
+
+    // sum the costs of the local slices, rank 0 holds the frequent itemsets with their global support
+    local_costs[0] = trimmed_size;
+    local_costs[1] = bfs_cost;
+    Policy::reduce_sum(local_costs, costs, 2);
+
+    if(my_rank == 0 && !freq_itemsets.empty()){
+        trimmed_size = costs[0];
+        bfs_cost = costs[1];
+
+        // itemsets sharing their first n-2 items form a class and are intersected pairwise
+        size_t class_start = 0;
+        for(size_t i=0; i<=freq_itemsets.size(); i++){
+            if(i < freq_itemsets.size() && freq_itemsets[i].substr(0, freq_itemsets[i].rfind(' ')+1) == freq_itemsets[class_start].substr(0, freq_itemsets[class_start].rfind(' ')+1)){
+                continue;
+            }
+            for(size_t j=class_start; j<i; j++){
+                dfs_cost += dictionary[freq_itemsets[j]]*tot_lines*(i-class_start-1);
+                tids_size += dictionary[freq_itemsets[j]]*tot_lines;
+            }
+            class_start = i;
+        }
+        dfs_cost += trimmed_size;
+
+        // every rank holds the tid-lists of the whole trimmed dataset
+        depth_first = (trimmed_size + tids_size)*sizeof(int) <= hybrid_budget*1024*1024 && dfs_cost < bfs_cost;
+    }
+
+    Policy::broadcast(depth_first);
+
+    return depth_first;
+}
+
+// mine every frequent itemset extending freq_itemsets depth-first (Eclat), intersecting the tid-lists
+// of the itemsets in the same class instead of scanning matrix again: the tid-lists of the local slices
+// are gathered on every rank, then the subtrees are dealt round-robin and collected on rank 0
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::depth_first_mining(vector< vector<Item> > &rows, vector<string> &row_items, vector<string> &single_candidates, vector<string> &freq_itemsets, map<string,float> &dictionary, float min_support, int tot_lines, int local_start, int my_rank, int comm_sz){
+    vector< vector<int> > item_tids;
+    vector< vector<string> > class_itemsets;
+    vector< vector<string> > class_last_items;
+    vector< vector< vector<int> > > class_tids;
+    vector<int> tid_list;
+    map<string,float> itemsets_found;
+    vector<int> temp;
+    vector<string> itemset;
+    string item;
+    string prefix;
+    stringstream ss;
+
+    // only the items of the candidates can be extended further
+    vector<string> items(single_candidates);
+    sort(items.begin(), items.end());
+
+    // position in items of every id of the rows, -1 for the items that are not extended
+    vector<int> positions(row_items.size(), -1);
+    for (size_t i = 0; i < items.size(); i++){
+        positions[lower_bound(row_items.begin(), row_items.end(), items[i]) - row_items.begin()] = i;
+    }
+
+    // vertical layout of the trimmed rows: tid-list of every item
+    item_tids.resize(items.size());
+    for (size_t i = 0; i < rows.size(); i++){
+        for (size_t j = 0; j < rows[i].size(); j++){
+            if(positions[rows[i][j]] >= 0){
+                item_tids[positions[rows[i][j]]].push_back(local_start + i);
+            }
+        }
+    }
+
+    Policy::gather_tids(item_tids, comm_sz);
+
+    // tid-list of every frequent itemset, grouped in classes sharing all items but the last one
+    for(size_t i=0; i<freq_itemsets.size(); i++){
+        itemset.clear();
+        ss << freq_itemsets[i];
+        while(getline (ss, item, ' ')) {
+            itemset.push_back(item);
+        }
+        ss.clear();
+
+        // an itemset with an item outside the candidates joins no other itemset, so it is not extended
+        bool extendable = true;
+        for(size_t j=0; j<itemset.size(); j++){
+            if(!binary_search(items.begin(), items.end(), itemset[j])) extendable = false;
+        }
+        if(!extendable) continue;
+
+        tid_list = item_tids[lower_bound(items.begin(), items.end(), itemset[0]) - items.begin()];
+        for(size_t j=1; j<itemset.size(); j++){
+            vector<int> &tids = item_tids[lower_bound(items.begin(), items.end(), itemset[j]) - items.begin()];
+            temp.clear();
+            set_intersection(tid_list.begin(), tid_list.end(), tids.begin(), tids.end(), back_inserter(temp));
+            tid_list.swap(temp);
+        }
+
+        if(class_itemsets.empty() || freq_itemsets[i].substr(0, freq_itemsets[i].rfind(' ')+1) != prefix){
+            prefix = freq_itemsets[i].substr(0, freq_itemsets[i].rfind(' ')+1);
+            class_itemsets.push_back(vector<string>());
+            class_last_items.push_back(vector<string>());
+            class_tids.push_back(vector< vector<int> >());
+        }
+        class_itemsets.back().push_back(freq_itemsets[i]);
+        class_last_items.back().push_back(itemset.back());
+        class_tids.back().push_back(tid_list);
+    }
+
+    // every (class, itemset) pair roots an independent subtree: deal them round-robin among ranks,
+    // then share the ones of this rank dynamically among threads
+    vector< pair<int,int> > tasks;
+    int task = 0;
+    for(size_t c=0; c<class_itemsets.size(); c++){
+        for(size_t i=0; i<class_itemsets[c].size(); i++){
+            if(task++ % comm_sz == my_rank){
+                tasks.push_back(make_pair(c, i));
+            }
+        }
+    }
+
+    #pragma omp parallel
+    {
+        map<string,float> thread_itemsets;
+
+        #pragma omp for schedule(dynamic)
+        for(size_t t=0; t<tasks.size(); t++){
+            extend_itemset(tasks[t].second, class_itemsets[tasks[t].first], class_last_items[tasks[t].first], class_tids[tasks[t].first], thread_itemsets, min_support, tot_lines);
+        }
+
+        #pragma omp critical
+        itemsets_found.insert(thread_itemsets.begin(), thread_itemsets.end());
+    }
+
+    Policy::collect_itemsets(itemsets_found, my_rank, comm_sz);
+
+    if(my_rank == 0){
+        dictionary.insert(itemsets_found.begin(), itemsets_found.end());
+    }
+}
+
+// extend itemsets[i] with the last item of each following itemset of its class, then recurse on the new class
+template <class Policy>
+void Apriori<Policy>::extend_itemset(int i, vector<string> &itemsets, vector<string> &last_items, vector< vector<int> > &tids, map<string,float> &itemsets_found, float min_support, int n_rows){
+    vector<string> new_itemsets;
+    vector<string> new_last_items;
+    vector< vector<int> > new_tids;
+    vector<int> tid_list;
+    float support;
+
+    for(size_t j = i+1; j < itemsets.size(); j++){
+        tid_list.clear();
+        set_intersection(tids[i].begin(), tids[i].end(), tids[j].begin(), tids[j].end(), back_inserter(tid_list));
+        support = float(tid_list.size())/float(n_rows);
+        if(support < min_support) continue;
+
+        new_itemsets.push_back(itemsets[i] + " " + last_items[j]);
+        new_last_items.push_back(last_items[j]);
+        new_tids.push_back(tid_list);
+        itemsets_found[new_itemsets.back()] = support;
+    }
+
+    for(size_t j = 0; j < new_itemsets.size(); j++){
+        extend_itemset(j, new_itemsets, new_last_items, new_tids, itemsets_found, min_support, n_rows);
+    }
+}
+
+// out-of-core mining: the rows are never held in memory, after the counting pass every rank writes its
+// slice to a compact spill file of its own that is streamed through a fixed size buffer at every level,
+// so that only candidates and counters are kept in memory; with -fuse the speculated levels are counted
+// in the same pass and summed in the same reduction; returns the number of rows
+template <class Policy>
+int Apriori<Policy>::stream_mining(char file_name[], char spill_file[], map<string,float> &dictionary, float min_support, int fuse_threshold, int fuse_depth, int my_rank, int comm_sz){
+    vector<string> candidates;
+    vector<string> single_candidates;
+    vector<string> item_names;
+    int local_start = 0, local_end = 0;
+    int local_lines;
+    int tot_lines;
+
+    compute_local_start_end(file_name, my_rank, comm_sz, &local_start, &local_end);
+
+    local_lines = count_items(file_name, local_start, local_end, dictionary);
+    tot_lines = Policy::sum_all(local_lines);
+
+    // prune 1-itemsets with support < min_support, every rank gets the frequent items to encode its slice
+    reduce_itemsets(dictionary, min_support, tot_lines, my_rank, comm_sz, item_names);
+    if(!item_names.empty()){
+        update_candidates(candidates, item_names, single_candidates);
+    }
+
+    // ids follow the sorted order of the frequent items, so decoded rows are sorted as in read_file
+    string local_spill_file = string(spill_file) + "." + to_string(my_rank);
+    write_spill_file(file_name, local_start, local_end, &local_spill_file[0], item_names);
+
+    if(item_names.size() <= NARROW_ITEMS){
+        stream_levels<uint16_t>(local_spill_file, item_names, candidates, single_candidates, dictionary, min_support, tot_lines, fuse_threshold, fuse_depth, my_rank, comm_sz);
+    }
+    else{
+        stream_levels<uint32_t>(local_spill_file, item_names, candidates, single_candidates, dictionary, min_support, tot_lines, fuse_threshold, fuse_depth, my_rank, comm_sz);
+    }
+
+    remove(local_spill_file.c_str());
+
+    return tot_lines;
+}
+
+// the levels of the streaming mode from 2, on the spill file of this rank, which holds the rows as ids of
+// item_names: every pass matches the rows of each block against a prefix tree of the candidates of its levels
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::stream_levels(string &spill_file, vector<string> &item_names, vector<string> &candidates, vector<string> &single_candidates, map<string,float> &dictionary, float min_support, int tot_lines, int fuse_threshold, int fuse_depth, int my_rank, int comm_sz){
+    vector< vector<string> > levels;
+    vector< vector<string> > level_singles;
+    vector<string> pass_candidates;
+    vector< vector<Item> > block;
+    map<string,float> fused_dictionary;
+    vector<char> buffer(STREAM_BUFFER_SIZE);
+    vector<char> trie_buffer;
+    CandidateTrie<Item> trie;
+    vector<int> counts;
+    vector<int> block_counts;
+    LevelTrace level;
+    int buffer_start, buffer_end;
+
+    int n = 2; // starting from 2-itemset
+    while(!candidates.empty()){
+        levels.clear();
+        level_singles.clear();
+        if((int)candidates.size() < fuse_threshold){
+            speculate_levels(candidates, single_candidates, fuse_threshold, fuse_depth, levels, level_singles);
+        }
+        else{
+            levels.push_back(candidates);
+            level_singles.push_back(single_candidates);
+        }
+
+        pass_candidates.clear();
+        for (size_t l = 0; l < levels.size(); l++){
+            pass_candidates.insert(pass_candidates.end(), levels[l].begin(), levels[l].end());
+        }
+        build_trie<Item>(pass_candidates, item_names, trie_buffer);
+        trie.view(trie_buffer.data());
+        counts.assign(trie.n_nodes, 0);
+
+        ifstream spill (spill_file.c_str(), ios::binary);
+        buffer_start = 0;
+        buffer_end = 0;
+        while(read_spill_block(spill, buffer, buffer_start, buffer_end, block)){
+            count_trie(block, trie, block_counts, level);
+            for (size_t c = 0; c < counts.size(); c++){
+                counts[c] += block_counts[c];
+            }
+        }
+        spill.close();
+
+        fused_dictionary.clear();
+        Policy::sum_node_counts(counts);
+        trie_counts(trie, item_names, counts, 0, "", fused_dictionary);
+        reduce_levels(fused_dictionary, levels.size(), candidates, single_candidates, dictionary, min_support, tot_lines, n, false, my_rank, comm_sz);
+    }
+}
+
+// first pass of the streaming mode: parse the local slice as read_file does, counting the items without storing the rows
+template <class Policy>
+int Apriori<Policy>::count_items(char file_name[], int local_start, int local_end, map<string,float> &dictionary){
+    int n_rows = 0;
+    int line_index = 0;
+    LineReader myfile (file_name);
+
+    string line;
+    stringstream ss;
+    string item;
+
+    while(getline (myfile, line)){
+        if(line_index >= local_start && line_index < local_end){
+            ss << line;
+
+            while(getline (ss, item, ' ')) {
+                item.erase(remove(item.begin(), item.end(), '\r'), item.end());
+                // insert item into dictionary and increment its value
+                dictionary[item]++;
+            }
+
+            ss.clear();
+            n_rows++;
+        }
+
+        if(line_index >= local_end) break;
+        line_index++;
+    }
+
+    check_input(myfile, file_name);
+    myfile.close();
+
+    return n_rows;
+}
+
+// second pass of the streaming mode: write every row restricted to the frequent items (item_names, sorted)
+// as its length followed by the gaps between the sorted ids of its items, all varint coded; rows with less
+// than two frequent items can not contain any candidate and are dropped
+template <class Policy>
+void Apriori<Policy>::write_spill_file(char file_name[], int local_start, int local_end, char spill_file[], vector<string> &item_names){
+    int line_index = 0;
+    LineReader myfile (file_name);
+    ofstream spill (spill_file, ios::binary);
+
+    vector<char> buffer;
+    vector<int> row;
+    string line;
+    stringstream ss;
+    string item;
+
+    while(getline (myfile, line)){
+        if(line_index >= local_end) break;
+        if(line_index++ < local_start) continue;
+
+        ss << line;
+
+        while(getline (ss, item, ' ')) {
+            item.erase(remove(item.begin(), item.end(), '\r'), item.end());
+            vector<string>::iterator itr = lower_bound(item_names.begin(), item_names.end(), item);
+            if(itr != item_names.end() && *itr == item){
+                row.push_back(itr - item_names.begin());
+            }
+        }
+
+        if(row.size() >= 2){
+            sort(row.begin(), row.end());
+            encode_varint(row.size(), buffer);
+            for(size_t i=0; i<row.size(); i++){
+                encode_varint(i == 0 ? row[i] : row[i] - row[i-1], buffer);
+            }
+        }
+
+        if(buffer.size() >= STREAM_BUFFER_SIZE){
+            spill.write(&buffer[0], buffer.size());
+            buffer.clear();
+        }
+
+        ss.clear();
+        row.clear();
+    }
+
+    if(!buffer.empty()){
+        spill.write(&buffer[0], buffer.size());
+    }
+
+    spill.close();
+    check_input(myfile, file_name);
+    myfile.close();
+}
+
+// append value to buffer as a varint: 7 bits per byte, high bit set on all bytes but the last
+template <class Policy>
+void Apriori<Policy>::encode_varint(unsigned int value, vector<char> &buffer){
+    while(value >= 128){
+        buffer.push_back((char)((value & 127) | 128));
+        value >>= 7;
+    }
+    buffer.push_back((char)value);
+}
+
+// read a varint starting at buffer[pos], false if it does not end before buffer_end
+template <class Policy>
+bool Apriori<Policy>::decode_varint(vector<char> &buffer, int &pos, int buffer_end, unsigned int &value){
+    int shift = 0;
+    value = 0;
+    while(pos < buffer_end){
+        unsigned char byte = buffer[pos++];
+        value |= (unsigned int)(byte & 127) << shift;
+        if(byte < 128) return true;
+        shift += 7;
+    }
+    return false;
+}
+
+// decode the complete rows in buffer into block, as item ids, after refilling it from spill, the incomplete row at
+// the end is kept for the next call; false once the whole spill file has been decoded
+template <class Policy>
+template <class Item>
+bool Apriori<Policy>::read_spill_block(ifstream &spill, vector<char> &buffer, int &buffer_start, int &buffer_end, vector< vector<Item> > &block){
+    vector<Item> row;
+    unsigned int length;
+    unsigned int gap;
+    unsigned int id;
+    int pos;
+
+    block.clear();
+
+    // move the incomplete row at the beginning of the buffer and fill the rest
+    memmove(&buffer[0], &buffer[buffer_start], buffer_end - buffer_start);
+    buffer_end -= buffer_start;
+    buffer_start = 0;
+    spill.read(&buffer[buffer_end], buffer.size() - buffer_end);
+    buffer_end += spill.gcount();
+
+    pos = 0;
+    while(decode_varint(buffer, pos, buffer_end, length)){
+        row.clear();
+        id = 0;
+        while(row.size() < length && decode_varint(buffer, pos, buffer_end, gap)){
+            id += gap;
+            row.push_back(id);
+        }
+        if(row.size() < length) break;
+
+        block.push_back(row);
+        buffer_start = pos;
+    }
+
+    if(block.empty()){
+        // a single row larger than the whole buffer: make room for it and try again
+        if(buffer_end == (int)buffer.size()){
+            buffer.resize(buffer.size()*2);
+            return read_spill_block(spill, buffer, buffer_start, buffer_end, block);
+        }
+        return false;
+    }
+
+    return true;
+}
+
+// Partition algorithm (Savasere et al.): every rank mines its slice in memory in chunks of chunk_rows
+// rows and, as an itemset frequent in the whole dataset is frequent in at least one chunk, the union of
+// the local results is sent to every rank and verified with a single counting scan of the slices; the
+// dataset is read twice whatever the depth of the itemsets; returns the number of rows
+template <class Policy>
+int Apriori<Policy>::partition_mining(char file_name[], int chunk_rows, map<string,float> &dictionary, float min_support, int my_rank, int comm_sz){
+    vector< vector<string> > matrix;
+    vector< vector<string> > next_matrix;
+    map<string,float> local_itemsets;
+    map<string,float> local_candidates;
+    vector<string> candidates_list;
+    set<string> candidates;
+    int local_start = 0, local_end = 0;
+    int local_lines = 0;
+    int tot_lines;
+    int rows;
+    int next_rows;
+    string line;
+
+    compute_local_start_end(file_name, my_rank, comm_sz, &local_start, &local_end);
+
+    // first scan: locally frequent itemsets of every chunk of the slice; a short last chunk would make
+    // almost every itemset of its rows locally frequent, so it is merged into the previous one
+    LineReader myfile (file_name);
+    for(int i=0; i<local_start; i++){
+        getline (myfile, line);
+    }
+    rows = read_chunk(myfile, min(chunk_rows, local_end - local_start), matrix);
+    while(rows > 0){
+        next_rows = read_chunk(myfile, min(chunk_rows, local_end - local_start - local_lines - rows), next_matrix);
+        if(next_rows > 0 && next_rows < chunk_rows/2){
+            matrix.insert(matrix.end(), next_matrix.begin(), next_matrix.end());
+            next_matrix.clear();
+            next_rows = 0;
+        }
+
+        local_itemsets.clear();
+        mine_chunk(matrix, min_support, local_itemsets);
+        for (map<string, float>::iterator i = local_itemsets.begin(); i != local_itemsets.end(); ++i) {
+            local_candidates[i->first] = 0;
+        }
+        local_lines += matrix.size();
+
+        matrix.swap(next_matrix);
+        next_matrix.clear();
+        rows = next_rows;
+    }
+    check_input(myfile, file_name);
+    myfile.close();
+
+    tot_lines = Policy::sum_all(local_lines);
+
+    // union of the local results on every rank
+    Policy::collect_itemsets(local_candidates, my_rank, comm_sz);
+    if(my_rank == 0){
+        for (map<string, float>::iterator i = local_candidates.begin(); i != local_candidates.end(); ++i) {
+            candidates_list.push_back(i->first);
+        }
+    }
+    Policy::broadcast_itemsets(candidates_list, my_rank);
+    candidates.insert(candidates_list.begin(), candidates_list.end());
+
+    // second scan: frequency of the union in the slice, summed on rank 0
+    myfile.open(file_name);
+    for(int i=0; i<local_start; i++){
+        getline (myfile, line);
+    }
+    local_lines = 0;
+    while(local_lines < local_end - local_start && (rows = read_chunk(myfile, min(chunk_rows, local_end - local_start - local_lines), matrix)) > 0){
+        #pragma omp parallel
+        {
+            map<string,float> thread_counts;
+
+            #pragma omp for
+            for (size_t i = 0; i < matrix.size(); i++){
+                count_candidates(matrix[i], candidates, thread_counts, -1, "");
+            }
+
+            #pragma omp critical
+            for (map<string, float>::iterator i = thread_counts.begin(); i != thread_counts.end(); ++i) {
+                dictionary[i->first] += i->second;
+            }
+        }
+        local_lines += rows;
+        matrix.clear();
+    }
+    check_input(myfile, file_name);
+    myfile.close();
+
+    Policy::collect_itemsets(dictionary, my_rank, comm_sz);
+
+    if(my_rank == 0){
+        // divide frequency by number of rows to calculate support and prune
+        for (map<string, float>::iterator it = dictionary.begin(); it != dictionary.end(); ){ // like a while
+            it->second = it->second/float(tot_lines);
+            if (it->second < min_support){
+                dictionary.erase(it++);
+            }
+            else{
+                ++it;
+            }
+        }
+    }
+
+    return tot_lines;
+}
+
+// read up to max_rows lines of myfile into matrix, parsed and sorted as in read_file; returns the rows read
+template <class Policy>
+int Apriori<Policy>::read_chunk(LineReader &myfile, int max_rows, vector< vector<string> > &matrix){
+    int rows = 0;
+
+    vector<string> row;
+    string line;
+    stringstream ss;
+    string item;
+
+    while(rows < max_rows && getline (myfile, line)){
+        ss << line;
+
+        while(getline (ss, item, ' ')) {
+            item.erase(remove(item.begin(), item.end(), '\r'), item.end());
+            row.push_back(item);
+        }
+
+        sort(row.begin(), row.end());
+        matrix.push_back(row);
+
+        ss.clear();
+        row.clear();
+        rows++;
+    }
+
+    return rows;
+}
+
+// in-memory Eclat on one chunk: every itemset with support >= min_support inside the chunk
+template <class Policy>
+void Apriori<Policy>::mine_chunk(vector< vector<string> > &matrix, float min_support, map<string,float> &itemsets_found){
+    map<string, vector<int> > tids;
+    vector<string> items;
+    vector< vector<int> > item_tids;
+    float support;
+
+    // vertical layout of the chunk
+    for (int i = 0; i < (int)matrix.size(); i++){
+        for (size_t j = 0; j < matrix[i].size(); j++){
+            vector<int> &tid_list = tids[matrix[i][j]];
+            if(tid_list.empty() || tid_list.back() != i){
+                tid_list.push_back(i);
+            }
+        }
+    }
+
+    // frequent items form the first class, extended depth-first as in the hybrid engine
+    for (map<string, vector<int> >::iterator itr = tids.begin(); itr != tids.end(); ++itr) {
+        support = float(itr->second.size())/float(matrix.size());
+        if(support < min_support) continue;
+
+        items.push_back(itr->first);
+        item_tids.push_back(itr->second);
+        itemsets_found[itr->first] = support;
+    }
+
+    #pragma omp parallel
+    {
+        map<string,float> thread_itemsets;
+
+        #pragma omp for schedule(dynamic)
+        for(size_t i=0; i<items.size(); i++){
+            extend_itemset(i, items, items, item_tids, thread_itemsets, min_support, matrix.size());
+        }
+
+        #pragma omp critical
+        itemsets_found.insert(thread_itemsets.begin(), thread_itemsets.end());
+    }
+}
+
+// count in one row the candidates of the partition mode: being a union of frequent itemsets they are
+// closed under subsets, so an itemset is only extended while it is itself a candidate
+template <class Policy>
+void Apriori<Policy>::count_candidates(vector<string> &row, set<string> &candidates, map<string,float> &counts, int item_idx, string itemset){
+    string next;
+
+    for (size_t j = item_idx+1; j < row.size(); j++){
+        next = itemset.empty() ? row[j] : itemset + " " + row[j];
+        if(candidates.find(next) == candidates.end()) continue;
+
+        counts[next]++;
+        count_candidates(row, candidates, counts, j, next);
+    }
+}
+
+// Toivonen's sampling: every rank samples its slice and the sample is mined at the lowered threshold
+// sample_support, then the slices are scanned once to count the itemsets frequent in the sample and their
+// negative border, computed by rank 0 and broadcast. If no itemset of the border turns out frequent the
+// result is exact, otherwise the border of the frequent itemsets found so far is counted again until none
+// of it is frequent. On entry dictionary holds the local frequency of the 1-itemsets, on exit rank 0
+// holds every frequent itemset with its support
+template <class Policy>
+void Apriori<Policy>::sample_mining(vector< vector<string> > &matrix, map<string,float> &dictionary, int tot_lines, float min_support, float sample_fraction, float sample_support, int fuse_threshold, int fuse_depth, float hybrid_budget, int my_rank, int comm_sz){
+    RunTrace sample_trace; // not written: the trace covers the levels of the main mining
+    vector<string> sample_key; // the sample is mined without checkpoints
+    vector< vector<string> > sample;
+    map<string,float> sample_dictionary;
+    map<string,float> counts;
+    set<string> sample_itemsets;
+    set<string> freq_itemsets;
+    set<string> counted;
+    set<string> border;
+    set<string> to_count;
+    vector<string> to_count_list;
+    int missed = 0;
+    int done = 0;
+    int scans = 0;
+    int local_sample;
+    int tot_sample;
+    int sample_start = 0;
+    float support;
+
+    // random sample of the rows, with a fixed seed so that runs are reproducible
+    mt19937 generator(SAMPLE_SEED + my_rank);
+    uniform_real_distribution<float> uniform(0, 1);
+    for (size_t i = 0; i < matrix.size(); i++){
+        if(uniform(generator) < sample_fraction){
+            sample.push_back(matrix[i]);
+            for (size_t j = 0; j < matrix[i].size(); j++){
+                sample_dictionary[matrix[i][j]]++;
+            }
+        }
+    }
+
+    local_sample = sample.size();
+    tot_sample = Policy::sum_all(local_sample);
+    sample_start = Policy::exclusive_sum(local_sample);
+
+    mine_matrix(sample, sample_dictionary, tot_sample, sample_support, fuse_threshold, fuse_depth, hybrid_budget, false, sample_start, my_rank, comm_sz, NULL, false, sample_key, sample_trace);
+
+    // exact frequency of the single items on rank 0
+    Policy::collect_itemsets(dictionary, my_rank, comm_sz);
+
+    if(my_rank == 0){
+        for (map<string, float>::iterator i = sample_dictionary.begin(); i != sample_dictionary.end(); ++i) {
+            sample_itemsets.insert(i->first);
+        }
+
+        // single items frequent in the dataset but not in the sample are part of the border
+        for (map<string, float>::iterator it = dictionary.begin(); it != dictionary.end(); ){ // like a while
+            it->second = it->second/float(tot_lines);
+            counted.insert(it->first);
+            if (it->second < min_support){
+                dictionary.erase(it++);
+            }
+            else{
+                if(sample_itemsets.find(it->first) == sample_itemsets.end()) missed = 1;
+                ++it;
+            }
+        }
+
+        negative_border(sample_itemsets, border);
+        to_count = sample_itemsets;
+        to_count.insert(border.begin(), border.end());
+    }
+
+    while(!done){
+        // the itemsets to count are closed under subsets, as count_candidates needs
+        to_count_list.clear();
+        if(my_rank == 0){
+            to_count_list.assign(to_count.begin(), to_count.end());
+        }
+        Policy::broadcast_itemsets(to_count_list, my_rank);
+        to_count.clear();
+        to_count.insert(to_count_list.begin(), to_count_list.end());
+
+        counts.clear();
+        #pragma omp parallel
+        {
+            map<string,float> thread_counts;
+
+            #pragma omp for
+            for (size_t i = 0; i < matrix.size(); i++){
+                count_candidates(matrix[i], to_count, thread_counts, -1, "");
+            }
+
+            #pragma omp critical
+            for (map<string, float>::iterator i = thread_counts.begin(); i != thread_counts.end(); ++i) {
+                counts[i->first] += i->second;
+            }
+        }
+        scans++;
+
+        Policy::collect_itemsets(counts, my_rank, comm_sz);
+
+        if(my_rank == 0){
+            for (set<string>::iterator i = to_count.begin(); i != to_count.end(); ++i) {
+                if(counted.find(*i) != counted.end()) continue;
+                counted.insert(*i);
+
+                support = counts[*i]/float(tot_lines);
+                if(support < min_support) continue;
+
+                dictionary[*i] = support;
+                if(border.find(*i) != border.end()) missed = 1;
+            }
+
+            done = 1;
+            if(missed){
+                // fallback: count the border of everything found frequent so far
+                missed = 0;
+                freq_itemsets.clear();
+                for (map<string, float>::iterator i = dictionary.begin(); i != dictionary.end(); ++i) {
+                    freq_itemsets.insert(i->first);
+                }
+                border.clear();
+                negative_border(freq_itemsets, border);
+                for (set<string>::iterator i = counted.begin(); i != counted.end(); ++i) {
+                    border.erase(*i);
+                }
+                to_count = freq_itemsets;
+                to_count.insert(border.begin(), border.end());
+                done = border.empty();
+            }
+        }
+
+        Policy::broadcast(done);
+    }
+
+    if(my_rank == 0){
+        cout<<"Full scans: "<<scans<<endl;
+    }
+}
+
+// negative border of a family of itemsets closed under subsets, without the single items: the itemsets
+// outside the family whose immediate subsets all belong to it, generated joining the itemsets of the
+// family with the same length that share all items but the last one
+template <class Policy>
+void Apriori<Policy>::negative_border(set<string> &itemsets, set<string> &border){
+    map<int, vector<string> > lengths;
+    vector<string> items;
+    string item;
+    string prefix;
+    string candidate;
+    string subset;
+    stringstream ss;
+    bool closed;
+
+    // set order keeps the itemsets of a class next to each other
+    for (set<string>::iterator i = itemsets.begin(); i != itemsets.end(); ++i) {
+        lengths[count(i->begin(), i->end(), ' ') + 1].push_back(*i);
+    }
+
+    for (map<int, vector<string> >::iterator l = lengths.begin(); l != lengths.end(); ++l) {
+        vector<string> &level = l->second;
+        for(size_t i=0; i<level.size(); i++){
+            prefix = level[i].substr(0, level[i].rfind(' ')+1);
+            for(size_t j=i+1; j<level.size() && level[j].compare(0, prefix.size(), prefix) == 0; j++){
+                candidate = level[i] + " " + level[j].substr(prefix.size());
+                if(itemsets.find(candidate) != itemsets.end()) continue;
+
+                items.clear();
+                ss << candidate;
+                while(getline (ss, item, ' ')) {
+                    items.push_back(item);
+                }
+                ss.clear();
+
+                // the subsets without one of the last two items are level[i] and level[j]
+                closed = true;
+                for(int r=0; r<(int)items.size()-2 && closed; r++){
+                    subset.clear();
+                    for(int k=0; k<(int)items.size(); k++){
+                        if(k != r) subset += " " + items[k];
+                    }
+                    closed = itemsets.find(subset.erase(0,1)) != itemsets.end();
+                }
+                if(closed){
+                    border.insert(candidate);
+                }
+            }
+        }
+    }
+}
+
+// FUP incremental update (Cheung et al.): state_file holds the frequent itemsets of file_name with their
+// counts and delta_file the rows appended since, both split among ranks. Every level is counted on the
+// delta only; an itemset that was not frequent in file_name is counted again on the slices of file_name
+// only if its count in the delta can make up for the gap to the new threshold, bounded by the old min
+// support and by the old counts of its subsets. On exit rank 0 holds in dictionary every frequent itemset of both files with its support;
+// returns the total number of rows, -1 if state_file was mined with a higher min support
+template <class Policy>
+int Apriori<Policy>::fup_mining(char file_name[], char delta_file[], char state_file[], map<string,float> &dictionary, float min_support, int my_rank, int comm_sz){
+    vector< vector<string> > delta;
+    vector< vector<string> > chunk;
+    map<string,float> old_counts; // itemsets whose count in file_name is known, from the state or counted again
+    map<string,float> delta_counts;
+    map<string,float> rescan_counts;
+    map<string,float> temp_dictionary;
+    vector<string> candidates;
+    vector<string> single_candidates;
+    vector<string> freq_itemsets;
+    vector<string> rescan;
+    set<string> level;
+    vector<string> items;
+    string subset;
+    stringstream ss;
+    string item;
+    string line;
+    int local_start = 0, local_end = 0;
+    int old_start = 0, old_end = 0;
+    int local_lines;
+    int old_rows = 0;
+    int delta_rows;
+    int tot_rows;
+    int scans = 0;
+    float old_support = 0;
+    float count;
+    float bound;
+    int max_infrequent;
+
+    // only rank 0 needs the old itemsets
+    if(my_rank == 0){
+        load_state(state_file, old_counts, old_rows, old_support);
+    }
+    Policy::broadcast(old_rows);
+    Policy::broadcast(old_support);
+    if(min_support < old_support){
+        if(my_rank == 0){
+            cout<<"Min support lower than the "<<old_support<<" of "<<state_file<<", mine the whole dataset instead"<<endl;
+        }
+        return -1;
+    }
+
+    // delta rows of the slice and their 1-itemsets
+    compute_local_start_end(delta_file, my_rank, comm_sz, &local_start, &local_end);
+    read_file(delta_file, local_start, local_end, delta, delta_counts);
+    local_lines = delta.size();
+    delta_rows = Policy::sum_all(local_lines);
+    tot_rows = old_rows + delta_rows;
+
+    // the old data is split by its row count in the state, without reading it
+    compute_local_range(old_rows, my_rank, comm_sz, &old_start, &old_end);
+
+    Policy::collect_itemsets(delta_counts, my_rank, comm_sz);
+    if(my_rank == 0){
+        for (map<string, float>::iterator i = delta_counts.begin(); i != delta_counts.end(); ++i) {
+            level.insert(i->first);
+        }
+        for (map<string, float>::iterator i = old_counts.begin(); i != old_counts.end(); ++i) {
+            if(i->first.find(' ') == string::npos) level.insert(i->first);
+        }
+    }
+
+    // highest count that was below the old min support, by the same test used to prune
+    max_infrequent = int(old_support*old_rows);
+    while(max_infrequent > 0 && max_infrequent/float(old_rows) >= old_support) max_infrequent--;
+    while((max_infrequent+1)/float(old_rows) < old_support) max_infrequent++;
+
+    int n = 1; // starting from 1-itemset
+    while(true){
+        temp_dictionary.clear();
+        rescan.clear();
+
+        if(my_rank == 0){
+            for (set<string>::iterator i = level.begin(); i != level.end(); ++i) {
+                count = delta_counts.count(*i) ? delta_counts[*i] : 0;
+                if(old_counts.count(*i)){
+                    temp_dictionary[*i] = old_counts[*i] + count;
+                }
+                // not known before: its old count is below the old min support and the old counts of its subsets,
+                // so it needs its old count only if the delta can make up for the gap
+                else{
+                    bound = max_infrequent;
+                    items.clear();
+                    ss << *i;
+                    while(getline (ss, item, ' ')) {
+                        items.push_back(item);
+                    }
+                    ss.clear();
+                    for(size_t r=0; r<items.size() && items.size() > 1; r++){
+                        subset.clear();
+                        for(size_t k=0; k<items.size(); k++){
+                            if(k != r) subset += " " + items[k];
+                        }
+                        subset.erase(0,1);
+                        if(old_counts.count(subset)) bound = min(bound, old_counts[subset]);
+                    }
+                    if((bound + count)/float(tot_rows) >= min_support){
+                        rescan.push_back(*i);
+                    }
+                }
+            }
+        }
+
+        Policy::broadcast_itemsets(rescan, my_rank);
+
+        if(!rescan.empty()){
+            rescan_counts.clear();
+            LineReader myfile (file_name);
+            for(int i=0; i<old_start; i++){
+                getline (myfile, line);
+            }
+            local_lines = 0;
+            while(local_lines < old_end - old_start && read_chunk(myfile, min(RESCAN_CHUNK_ROWS, old_end - old_start - local_lines), chunk) > 0){
+                count_itemsets(chunk, rescan, rescan_counts);
+                local_lines += chunk.size();
+                chunk.clear();
+            }
+            check_input(myfile, file_name);
+            myfile.close();
+            scans++;
+
+            Policy::collect_itemsets(rescan_counts, my_rank, comm_sz);
+            if(my_rank == 0){
+                for (size_t i = 0; i < rescan.size(); i++){
+                    old_counts[rescan[i]] = rescan_counts[rescan[i]];
+                    temp_dictionary[rescan[i]] = rescan_counts[rescan[i]] + delta_counts[rescan[i]];
+                }
+            }
+        }
+
+        // support over the rows of both files, pruned on rank 0 and sent to every rank
+        freq_itemsets.clear();
+        if(my_rank == 0){
+            for (map<string, float>::iterator it = temp_dictionary.begin(); it != temp_dictionary.end(); ){ // like a while
+                it->second = it->second/float(tot_rows);
+                if (it->second < min_support){
+                    temp_dictionary.erase(it++);
+                }
+                else{
+                    freq_itemsets.push_back(it->first);
+                    ++it;
+                }
+            }
+            dictionary.insert(temp_dictionary.begin(), temp_dictionary.end());
+        }
+        Policy::broadcast_itemsets(freq_itemsets, my_rank);
+
+        candidates.clear();
+        single_candidates.clear();
+        if(!freq_itemsets.empty()){
+            update_candidates(candidates, freq_itemsets, single_candidates);
+        }
+        if(candidates.empty()) break;
+        n++;
+
+        level.clear();
+        level.insert(candidates.begin(), candidates.end());
+
+        delta_counts.clear();
+        count_itemsets(delta, candidates, delta_counts);
+        Policy::collect_itemsets(delta_counts, my_rank, comm_sz);
+    }
+
+    if(my_rank == 0){
+        cout<<"Scans of the old data: "<<scans<<endl;
+    }
+
+    return tot_rows;
+}
+
+// write the frequent itemsets in dictionary with their absolute counts to state_file, preceded by the
+// number of rows and the min support they were mined with, for a later incremental update
+template <class Policy>
+void Apriori<Policy>::save_state(char state_file[], map<string,float> &dictionary, int n_rows, float min_support){
+    ofstream state (state_file);
+
+    state << n_rows << '\t' << setprecision(9) << min_support << '\n';
+    for (map<string, float>::iterator itr = dictionary.begin(); itr != dictionary.end(); ++itr) {
+        state << itr->first << '\t' << int(itr->second*double(n_rows) + 0.5) << '\n';
+    }
+
+    state.close();
+    // a partial state would be taken for the result of the run by the next update
+    if(state.fail()){
+        cerr<<state_file<<": cannot be written"<<endl;
+        Policy::abort();
+    }
+}
+
+template <class Policy>
+void Apriori<Policy>::load_state(char state_file[], map<string,float> &counts, int &n_rows, float &min_support){
+    ifstream state (state_file);
+    string line;
+    size_t tab;
+
+    n_rows = 0;
+    min_support = 0;
+    if(getline (state, line)){
+        tab = line.find('\t');
+        n_rows = atoi(line.substr(0, tab).c_str());
+        min_support = atof(line.substr(tab+1).c_str());
+    }
+    while(getline (state, line)){
+        tab = line.find('\t');
+        counts[line.substr(0, tab)] = atof(line.substr(tab+1).c_str());
+    }
+
+    state.close();
+}
+
+// top-K mining: the k most frequent itemsets of at most max_length items (0 = any length), with the ones
+// tied with the k-th. min_support starts from the given floor and rises to the k-th highest support seen so
+// far, kept by rank 0 in a min-heap, so that only itemsets that can still enter the top-k are kept and
+// extended
+template <class Policy>
+void Apriori<Policy>::topk_mining(vector< vector<string> > &matrix, map<string,float> &dictionary, int tot_lines, float min_support, int k, int max_length, int my_rank, int comm_sz){
+    priority_queue<float, vector<float>, greater<float> > top_supports;
+    map<string,float> temp_dictionary;
+    vector<string> candidates;
+    vector<string> single_candidates;
+
+    prune_topk(dictionary, top_supports, k, min_support, tot_lines, candidates, single_candidates, my_rank, comm_sz);
+
+    int n = 2; // starting from 2-itemset
+    while(!candidates.empty() && (max_length == 0 || n <= max_length)){
+        temp_dictionary.clear();
+        // read matrix and insert n-itemsets in temp_dictionary as key with their frequency as value
+        count_itemsets(matrix, candidates, temp_dictionary);
+        prune_topk(temp_dictionary, top_supports, k, min_support, tot_lines, candidates, single_candidates, my_rank, comm_sz);
+        if(my_rank == 0){
+            dictionary.insert(temp_dictionary.begin(), temp_dictionary.end());
+        }
+        n++;
+    }
+
+    if(my_rank == 0){
+        // drop the itemsets kept before the threshold reached its final value
+        for (map<string, float>::iterator it = dictionary.begin(); it != dictionary.end(); ){ // like a while
+            if (it->second < min_support){
+                dictionary.erase(it++);
+            }
+            else{
+                ++it;
+            }
+        }
+
+        cout<<"Top-"<<k<<" min support: "<<min_support<<endl;
+    }
+}
+
+// sum the counts of every rank on rank 0, raise the threshold with their supports, prune them
+// and send the ones left back to all ranks to generate the candidates
+template <class Policy>
+void Apriori<Policy>::prune_topk(map<string,float> &temp_dictionary, priority_queue<float, vector<float>, greater<float> > &top_supports, int k, float &min_support, int tot_lines, vector<string> &candidates, vector<string> &single_candidates, int my_rank, int comm_sz){
+    vector<string> freq_itemsets;
+
+    Policy::collect_itemsets(temp_dictionary, my_rank, comm_sz);
+
+    if(my_rank == 0){
+        normalise(temp_dictionary, tot_lines);
+        raise_threshold(temp_dictionary, top_supports, k, min_support);
+        for (map<string, float>::iterator it = temp_dictionary.begin(); it != temp_dictionary.end(); ){ // like a while
+            if (it->second < min_support){
+                temp_dictionary.erase(it++);
+            }
+            else{
+                freq_itemsets.push_back(it->first);
+                ++it;
+            }
+        }
+    }
+
+    Policy::broadcast_itemsets(freq_itemsets, my_rank);
+
+    candidates.clear(); // empty candidates to then update it
+    single_candidates.clear();
+
+    if(!freq_itemsets.empty()){
+        update_candidates(candidates, freq_itemsets, single_candidates);
+    }
+}
+
+// push the supports of a level into the min-heap of the k highest ones; once it is full its top is the
+// lowest support an itemset needs to enter the top-k, and no superset of a lower itemset can
+template <class Policy>
+void Apriori<Policy>::raise_threshold(map<string,float> &temp_dictionary, priority_queue<float, vector<float>, greater<float> > &top_supports, int k, float &min_support){
+    for (map<string, float>::iterator i = temp_dictionary.begin(); i != temp_dictionary.end(); ++i) {
+        top_supports.push(i->second);
+        if((int)top_supports.size() > k){
+            top_supports.pop();
+        }
+    }
+
+    if((int)top_supports.size() == k && top_supports.top() > min_support){
+        min_support = top_supports.top();
+    }
+}
+
+// closed itemsets, or only the maximal ones, with the prefix-preserving closure extension of LCM (Uno et
+// al.) on the tid-lists of the frequent items, gathered on every rank: from a closed itemset the search
+// jumps straight to the closure of every extension, so each closed itemset is reached exactly once and the
+// subsumed ones are never generated. The subtrees of the extensions of the root are dealt round-robin
+// among ranks. On entry dictionary holds the local frequency of the 1-itemsets, on exit rank 0 holds the
+// result
+template <class Policy>
+void Apriori<Policy>::closed_mining(vector< vector<string> > &matrix, map<string,float> &dictionary, int tot_lines, float min_support, bool maximal, int local_start, int my_rank, int comm_sz){
+    vector<string> items;
+    vector< vector<int> > item_tids;
+    vector< vector<int> > maximal_found;
+    map<string,float> itemsets_found;
+    vector<int> root;
+    vector<int> tids;
+    int min_count;
+    int n_rows = tot_lines;
+
+    // frequent items in sorted order on every rank, so that sorted ids give sorted itemsets
+    reduce_itemsets(dictionary, min_support, tot_lines, my_rank, comm_sz, items);
+    dictionary.clear();
+
+    item_tids.resize(items.size());
+    for (size_t i = 0; i < matrix.size(); i++){
+        for (size_t j = 0; j < matrix[i].size(); j++){
+            vector<string>::iterator itr = lower_bound(items.begin(), items.end(), matrix[i][j]);
+            if(itr != items.end() && *itr == matrix[i][j]){
+                item_tids[itr - items.begin()].push_back(local_start + i);
+            }
+        }
+    }
+    Policy::gather_tids(item_tids, comm_sz);
+
+    // lowest count whose support passes the test used to prune
+    min_count = int(min_support*n_rows);
+    while(min_count > 0 && (min_count-1)/float(n_rows) >= min_support) min_count--;
+    while(min_count/float(n_rows) < min_support) min_count++;
+
+    // the root is the closure of the empty itemset: the items of every row
+    for (int i = 0; i < n_rows; i++){
+        tids.push_back(i);
+    }
+    for (size_t i = 0; i < items.size(); i++){
+        if((int)item_tids[i].size() == n_rows) root.push_back(i);
+    }
+    if(my_rank == 0 && !root.empty() && (!maximal || root.size() == items.size())){
+        add_closed_itemset(root, tids.size(), items, itemsets_found, maximal_found, n_rows);
+    }
+
+    // the subtrees of the extensions of the root are independent: round-robin among ranks, then dynamic
+    // scheduling among the threads of each rank balances their sizes
+    #pragma omp parallel
+    {
+        map<string,float> thread_found;
+        vector< vector<int> > thread_maximal;
+
+        #pragma omp for schedule(dynamic)
+        for (int e = 0; e < (int)items.size(); e++){
+            if(!binary_search(root.begin(), root.end(), e) && e % comm_sz == my_rank){
+                expand_closed(root, tids, e, item_tids, items, min_count, maximal, thread_found, thread_maximal, n_rows);
+            }
+        }
+
+        #pragma omp critical
+        itemsets_found.insert(thread_found.begin(), thread_found.end());
+    }
+
+    Policy::collect_itemsets(itemsets_found, my_rank, comm_sz);
+
+    if(my_rank == 0){
+        dictionary.insert(itemsets_found.begin(), itemsets_found.end());
+    }
+}
+
+// visit the closed itemset with the given tid-list reached by extending with item core: output it, unless
+// only maximal itemsets are wanted and a frequent extension exists, then expand it with every item after core
+template <class Policy>
+void Apriori<Policy>::extend_closed(vector<int> &itemset, vector<int> &tids, int core, vector< vector<int> > &item_tids, vector<string> &items, int min_count, bool maximal, map<string,float> &itemsets_found, vector< vector<int> > &maximal_found, int n_rows){
+    vector<int> temp;
+    vector<int> tail;
+    bool extensible = false;
+
+    if(!maximal){
+        add_closed_itemset(itemset, tids.size(), items, itemsets_found, maximal_found, n_rows);
+    }
+    else{
+        for (int e = 0; e < (int)items.size(); e++){
+            if(binary_search(itemset.begin(), itemset.end(), e)) continue;
+
+            temp.clear();
+            set_intersection(tids.begin(), tids.end(), item_tids[e].begin(), item_tids[e].end(), back_inserter(temp));
+            if((int)temp.size() < min_count) continue;
+
+            extensible = true;
+            if(e > core) tail.push_back(e);
+        }
+
+        if(!extensible){
+            add_closed_itemset(itemset, tids.size(), items, itemsets_found, maximal_found, n_rows);
+            return;
+        }
+
+        // the whole subtree is made of subsets of itemset and tail: skip it if a maximal itemset found
+        // already includes them
+        temp.clear();
+        set_union(itemset.begin(), itemset.end(), tail.begin(), tail.end(), back_inserter(temp));
+        for (size_t i = 0; i < maximal_found.size(); i++){
+            if(includes(maximal_found[i].begin(), maximal_found[i].end(), temp.begin(), temp.end())) return;
+        }
+    }
+
+    for (size_t e = core+1; e < items.size(); e++){
+        if(!binary_search(itemset.begin(), itemset.end(), e)){
+            expand_closed(itemset, tids, e, item_tids, items, min_count, maximal, itemsets_found, maximal_found, n_rows);
+        }
+    }
+}
+
+// closure of itemset extended with item e: the items contained in every row of its tid-list. It is visited
+// only if the closure adds no item before e, otherwise it is reached from another branch of the search
+template <class Policy>
+void Apriori<Policy>::expand_closed(vector<int> &itemset, vector<int> &tids, int e, vector< vector<int> > &item_tids, vector<string> &items, int min_count, bool maximal, map<string,float> &itemsets_found, vector< vector<int> > &maximal_found, int n_rows){
+    vector<int> new_tids;
+    vector<int> closure;
+
+    set_intersection(tids.begin(), tids.end(), item_tids[e].begin(), item_tids[e].end(), back_inserter(new_tids));
+    if((int)new_tids.size() < min_count) return;
+
+    for (int i = 0; i < (int)items.size(); i++){
+        if(i == e || binary_search(itemset.begin(), itemset.end(), i)){
+            closure.push_back(i);
+        }
+        else if(item_tids[i].size() >= new_tids.size() && includes(item_tids[i].begin(), item_tids[i].end(), new_tids.begin(), new_tids.end())){
+            if(i < e) return;
+            closure.push_back(i);
+        }
+    }
+
+    extend_closed(closure, new_tids, e, item_tids, items, min_count, maximal, itemsets_found, maximal_found, n_rows);
+}
+
+template <class Policy>
+void Apriori<Policy>::add_closed_itemset(vector<int> &itemset, int count, vector<string> &items, map<string,float> &itemsets_found, vector< vector<int> > &maximal_found, int n_rows){
+    string key;
+
+    for (size_t i = 0; i < itemset.size(); i++){
+        key += " " + items[itemset[i]];
+    }
+    itemsets_found[key.erase(0,1)] = count/float(n_rows);
+    maximal_found.push_back(itemset);
+}
+
+// write the run trace as JSON from rank 0: the phases outside the levels, then every level with its sizes, the
+// time of each phase on rank 0 except counting, which is given for the slowest and the fastest rank, and the
+// bytes sent by all ranks; the fields of the ranks and of the threads only when the policy has them. Must be
+// called by every rank
+template <class Policy>
+void Apriori<Policy>::write_trace(char trace_file[], RunTrace &trace, int n_rows, double elapsed, int my_rank, int comm_sz){
+    int n_levels = trace.levels.size();
+    vector<double> count_times(n_levels), min_times(n_levels), max_times(n_levels);
+    vector<long long> bytes(n_levels), total_bytes(n_levels);
+    long rss = peak_rss();
+    long max_rss, total_rss;
+    double max_load;
+    FILE* out;
+    double thread_min, thread_max;
+    bool failed;
+
+    for (int l = 0; l < n_levels; l++){
+        count_times[l] = trace.levels[l].count_time;
+        bytes[l] = trace.levels[l].bytes_sent;
+    }
+    // imbalance among the ranks
+    Policy::reduce_min(count_times.data(), min_times.data(), n_levels);
+    Policy::reduce_max(count_times.data(), max_times.data(), n_levels);
+    Policy::reduce_sum(bytes.data(), total_bytes.data(), n_levels);
+    Policy::reduce_max(&trace.load_time, &max_load, 1);
+    Policy::reduce_max(&rss, &max_rss, 1);
+    Policy::reduce_sum(&rss, &total_rss, 1);
+
+    if(my_rank != 0) return;
+
+    out = fopen(trace_file, "w");
+    if(out == NULL){
+        cerr<<trace_file<<": cannot be written"<<endl;
+        Policy::abort();
+    }
+    fprintf(out, "{\n  \"program\": \"%s\",\n  \"rows\": %d,\n", Policy::program(), n_rows);
+    if(Policy::distributed){
+        fprintf(out, "  \"ranks\": %d,\n", comm_sz);
+    }
+    if(Policy::threads){
+        fprintf(out, "  \"threads\": %d,\n", Policy::max_threads());
+    }
+    fprintf(out, "  \"total_time\": %g,\n  \"load_time\": %g,\n  \"fused_time\": %g,\n  \"depth_first_time\": %g,\n  \"peak_rss_kb\": %ld,\n", elapsed, max_load, trace.fused_time, trace.depth_first_time, max_rss);
+    if(Policy::distributed){
+        fprintf(out, "  \"total_rss_kb\": %ld,\n", total_rss);
+    }
+    fprintf(out, "  \"levels\": [");
+    for (size_t l = 0; l < trace.levels.size(); l++){
+        LevelTrace &level = trace.levels[l];
+        fprintf(out, "%s\n    {\"k\": %d, \"candidates\": %d, \"frequent\": %d, \"count_time\": %g", l > 0 ? "," : "", level.k, level.candidates, level.frequent, max_times[l]);
+        if(Policy::distributed){
+            fprintf(out, ", \"count_time_min\": %g, \"normalise_time\": %g, \"reduce_time\": %g, \"prune_time\": %g, \"broadcast_time\": %g, \"generation_time\": %g, \"bytes_sent\": %lld",
+                    min_times[l], level.normalise_time, level.reduce_time, level.prune_time, level.broadcast_time, level.generation_time, total_bytes[l]);
+        }
+        else{
+            fprintf(out, ", \"normalise_time\": %g, \"prune_time\": %g, \"generation_time\": %g", level.normalise_time, level.prune_time, level.generation_time);
+        }
+        if(Policy::threads){
+            // the first level is counted while reading the file
+            thread_min = level.thread_times.empty() ? 0 : *min_element(level.thread_times.begin(), level.thread_times.end());
+            thread_max = level.thread_times.empty() ? 0 : *max_element(level.thread_times.begin(), level.thread_times.end());
+            fprintf(out, ", \"thread_count_time_min\": %g, \"thread_count_time_max\": %g", thread_min, thread_max);
+        }
+#ifdef APRIORI_PERF
+        fprintf(out, ", \"count_events\": ");
+        write_events(out, level.count_events);
+        fprintf(out, ", \"generation_events\": ");
+        write_events(out, level.generation_events);
+        if(Policy::threads){
+            fprintf(out, ", \"thread_events\": [");
+            for (size_t t = 0; t < level.thread_events.size(); t++){
+                if(t > 0) fprintf(out, ", ");
+                write_events(out, level.thread_events[t]);
+            }
+            fprintf(out, "]");
+        }
+#endif
+        fprintf(out, "}");
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    failed = ferror(out) != 0;
+    if(fclose(out) != 0 || failed){
+        cerr<<trace_file<<": cannot be written"<<endl;
+        Policy::abort();
+    }
+}
+
+template <class Policy>
+double Apriori<Policy>::wall_time(){
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+
+    return now.tv_sec + now.tv_usec/1000000.0;
+}
+
+// open and start the hardware counters of PERF_EVENTS for the calling thread, when built with APRIORI_PERF
+template <class Policy>
+void Apriori<Policy>::perf_start(vector<int> &fds){
+#ifdef APRIORI_PERF
+    struct perf_event_attr attr;
+
+    fds.assign(PERF_EVENTS, -1);
+    for (int e = 0; e < PERF_EVENTS; e++){
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPES[e];
+        attr.config = PERF_CONFIGS[e];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // pid 0 and cpu -1: the calling thread on any cpu
+        fds[e] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    for (int e = 0; e < PERF_EVENTS; e++){
+        if(fds[e] >= 0) ioctl(fds[e], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)fds;
+#endif
+}
+
+// stop and close the counters opened by perf_start, adding their values to values; an event the machine
+// or perf_event_paranoid does not allow is -1
+template <class Policy>
+void Apriori<Policy>::perf_stop(vector<int> &fds, vector<long long> &values){
+#ifdef APRIORI_PERF
+    long long count;
+
+    for (int e = 0; e < PERF_EVENTS; e++){
+        if(fds[e] >= 0) ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+    }
+    values.resize(PERF_EVENTS, 0);
+    for (int e = 0; e < PERF_EVENTS; e++){
+        if(fds[e] < 0 || read(fds[e], &count, sizeof(count)) != sizeof(count)){
+            values[e] = -1;
+        }
+        else if(values[e] >= 0){
+            values[e] += count;
+        }
+        if(fds[e] >= 0) close(fds[e]);
+    }
+#else
+    (void)fds;
+    (void)values;
+#endif
+}
+
+// total of the counters of every thread, -1 if an event was not counted by some thread
+template <class Policy>
+void Apriori<Policy>::perf_sum(vector< vector<long long> > &thread_values, vector<long long> &values){
+    for (size_t t = 0; t < thread_values.size(); t++){
+        values.resize(thread_values[t].size(), 0);
+        for (size_t e = 0; e < thread_values[t].size(); e++){
+            if(thread_values[t][e] < 0 || values[e] < 0){
+                values[e] = -1;
+            }
+            else{
+                values[e] += thread_values[t][e];
+            }
+        }
+    }
+}
+
+// write the counters of a phase as a JSON object
+template <class Policy>
+void Apriori<Policy>::write_events(FILE* out, vector<long long> &values){
+#ifdef APRIORI_PERF
+    fprintf(out, "{");
+    for (size_t e = 0; e < values.size(); e++){
+        fprintf(out, "%s\"%s\": %lld", e > 0 ? ", " : "", PERF_NAMES[e], values[e]);
+    }
+    fprintf(out, "}");
+#endif
+}
+
+// peak resident set size of the process, in KB
+template <class Policy>
+long Apriori<Policy>::peak_rss(){
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_maxrss;
+}
+
+// write dictionary to lattice_file as an indexed binary lattice, read by lattice_query: header, item table,
+// offset and size of the section of every itemset length, then the sections with the itemsets as item ids
+// sorted by decreasing count, so that a query at any threshold >= min_support reads only the head of the
+// sections it needs. Integers are written in the byte order of the machine
+template <class Policy>
+void Apriori<Policy>::write_lattice(char lattice_file[], map<string,float> &dictionary, int n_rows, float min_support){
+    ofstream lattice (lattice_file, ios::binary);
+    map<string,int> item_ids;
+    vector< vector< pair<int,string> > > sections;
+    vector<int> ids;
+    stringstream ss;
+    string item;
+    int length;
+    int n_items;
+    int n_sections;
+    long long offset;
+
+    for (map<string, float>::iterator i = dictionary.begin(); i != dictionary.end(); ++i) {
+        length = 0;
+        ss << i->first;
+        while(getline (ss, item, ' ')) {
+            item_ids[item] = 0;
+            length++;
+        }
+        ss.clear();
+
+        if((int)sections.size() < length) sections.resize(length);
+        // negated count: ascending order is by decreasing count, ties by itemset
+        sections[length-1].push_back(make_pair(-int(i->second*double(n_rows) + 0.5), i->first));
+    }
+    for (size_t i = 0; i < sections.size(); i++){
+        sort(sections[i].begin(), sections[i].end());
+    }
+
+    // ids follow the sorted order of the items, as the items inside an itemset
+    n_items = 0;
+    for (map<string, int>::iterator i = item_ids.begin(); i != item_ids.end(); ++i) {
+        i->second = n_items++;
+    }
+    n_sections = sections.size();
+
+    lattice.write(LATTICE_MAGIC, 8);
+    lattice.write((char*)&n_rows, sizeof(int));
+    lattice.write((char*)&min_support, sizeof(float));
+    lattice.write((char*)&n_items, sizeof(int));
+    lattice.write((char*)&n_sections, sizeof(int));
+
+    offset = 8 + 4*sizeof(int) + n_sections*(sizeof(long long) + sizeof(int));
+    for (map<string, int>::iterator i = item_ids.begin(); i != item_ids.end(); ++i) {
+        length = i->first.size();
+        lattice.write((char*)&length, sizeof(int));
+        lattice.write(i->first.data(), length);
+        offset += sizeof(int) + length;
+    }
+
+    // index: where the records of every length start and how many they are
+    for (int i = 0; i < n_sections; i++){
+        length = sections[i].size();
+        lattice.write((char*)&offset, sizeof(long long));
+        lattice.write((char*)&length, sizeof(int));
+        offset += (long long)length*(i+2)*sizeof(int);
+    }
+
+    // records: count followed by the ids of the items
+    for (int i = 0; i < n_sections; i++){
+        for (size_t j = 0; j < sections[i].size(); j++){
+            ids.clear();
+            ids.push_back(-sections[i][j].first);
+            ss << sections[i][j].second;
+            while(getline (ss, item, ' ')) {
+                ids.push_back(item_ids[item]);
+            }
+            ss.clear();
+            lattice.write((char*)&ids[0], ids.size()*sizeof(int));
+        }
+    }
+
+    lattice.close();
+    // lattice_query would read a truncated index or records as a smaller result
+    if(lattice.fail()){
+        cerr<<lattice_file<<": cannot be written"<<endl;
+        Policy::abort();
+    }
+}
+
+// association rules with confidence >= min_confidence and lift >= min_lift of every frequent itemset,
+// growing the consequents as in ap-genrules (Agrawal and Srikant): a consequent is extended only if all its
+// subsets passed min_confidence, since moving items from the antecedent to the consequent can only lower
+// the confidence; the lift, which has no such property, only filters the output. Itemsets are kept as
+// sorted item ids and their supports looked up in a hash table. Every rank gets the itemsets of rank 0 and
+// generates the rules of a contiguous block of them, written as they are produced through a buffer to
+// rules_file.<rank>, or gathered on rank 0 and printed if rules_file is NULL. A single process writes to
+// rules_file, or stdout, directly
+template <class Policy>
+void Apriori<Policy>::generate_association_rules(map<string,float> &dictionary, int n_rows, float min_confidence, float min_lift, char rules_file[], int format, int my_rank, int comm_sz){
+    vector<char> buffer;
+    string text;
+    string file_name;
+    FILE* out = stdout;
+    bool streaming = rules_file != NULL || !Policy::distributed;
+    bool failed;
+
+    // every rank streams its rules to a file of its own, otherwise they are gathered and printed by rank 0
+    if(rules_file != NULL){
+        file_name = Policy::distributed ? string(rules_file) + "." + to_string(my_rank) : string(rules_file);
+        out = fopen(file_name.c_str(), "wb");
+        if(out == NULL){
+            cerr<<file_name<<": cannot be written"<<endl;
+            Policy::abort();
+        }
+    }
+
+    Policy::share_dictionary(dictionary, my_rank);
+    if(narrow_ids(dictionary)){
+        generate_rules<uint16_t>(dictionary, n_rows, min_confidence, min_lift, format, out, streaming, my_rank, comm_sz, buffer);
+    }
+    else{
+        generate_rules<uint32_t>(dictionary, n_rows, min_confidence, min_lift, format, out, streaming, my_rank, comm_sz, buffer);
+    }
+
+    if(rules_file != NULL){
+        // rules cut short by a full disk would look like all of them
+        failed = ferror(out) != 0;
+        if(fclose(out) != 0 || failed){
+            cerr<<file_name<<": cannot be written"<<endl;
+            Policy::abort();
+        }
+    }
+    if(!streaming){
+        text.assign(buffer.begin(), buffer.end());
+        Policy::gather_text(text, my_rank, comm_sz);
+        if(my_rank == 0){
+            fwrite(text.data(), 1, text.size(), stdout);
+        }
+    }
+}
+
+// the rules of the block of itemsets of this rank with item ids of type Item, flushed to out as they are
+// produced if streaming, otherwise left in buffer
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::generate_rules(map<string,float> &dictionary, int n_rows, float min_confidence, float min_lift, int format, FILE* out, bool streaming, int my_rank, int comm_sz, vector<char> &buffer){
+    vector<string> items;
+    vector< vector<Item> > itemsets;
+    vector<float> supports;
+    unordered_map<vector<Item>, float, ItemsetHash> support_table;
+    int local_start, local_end;
+
+    build_itemset_table(dictionary, items, itemsets, supports);
+    support_table.reserve(itemsets.size());
+    for (size_t i = 0; i < itemsets.size(); i++){
+        support_table[itemsets[i]] = supports[i];
+    }
+    if(streaming || my_rank == 0){
+        write_rules_header(buffer, format, items);
+    }
+
+    local_start = (long long)itemsets.size()*my_rank/comm_sz;
+    local_end = (long long)itemsets.size()*(my_rank+1)/comm_sz;
+
+    if(streaming){
+        flush_rules(buffer, out);
+    }
+
+    // each thread fills a buffer of its own, written out whenever it is full
+    #pragma omp parallel
+    {
+        vector<char> thread_buffer;
+
+        #pragma omp for schedule(dynamic)
+        for (int i = local_start; i < local_end; i++){
+            if(itemsets[i].size() > 1){
+                itemset_rules(itemsets[i], supports[i], n_rows, items, support_table, min_confidence, min_lift, format, thread_buffer);
+            }
+            if(thread_buffer.size() >= STREAM_BUFFER_SIZE && streaming){
+                #pragma omp critical
+                flush_rules(thread_buffer, out);
+            }
+        }
+
+        #pragma omp critical
+        {
+            if(streaming){
+                flush_rules(thread_buffer, out);
+            }
+            else{
+                buffer.insert(buffer.end(), thread_buffer.begin(), thread_buffer.end());
+            }
+        }
+    }
+}
+
+// true if the items of dictionary fit 16-bit ids: the itemset tables then take half the memory and their
+// hash lookups touch half the cache lines
+template <class Policy>
+bool Apriori<Policy>::narrow_ids(map<string,float> &dictionary){
+    set<string> items;
+    stringstream ss;
+    string item;
+
+    // every item of every key: a closed or maximal result does not hold all the 1-itemsets
+    for (map<string, float>::iterator i = dictionary.begin(); i != dictionary.end() && items.size() <= NARROW_ITEMS; ++i) {
+        ss << i->first;
+        while(getline (ss, item, ' ')) {
+            items.insert(item);
+        }
+        ss.clear();
+    }
+
+    return items.size() <= NARROW_ITEMS;
+}
+
+// integer table of the itemsets in dictionary: item ids follow the sorted order of the items, so every
+// itemset is a sorted vector of ids
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::build_itemset_table(map<string,float> &dictionary, vector<string> &items, vector< vector<Item> > &itemsets, vector<float> &supports){
+    map<string,int> item_ids;
+    vector<Item> itemset;
+    stringstream ss;
+    string item;
+
+    // the items of every key, not only of the 1-itemsets, which a closed or maximal result may not hold
+    for (map<string, float>::iterator i = dictionary.begin(); i != dictionary.end(); ++i) {
+        ss << i->first;
+        while(getline (ss, item, ' ')) {
+            item_ids[item] = 0;
+        }
+        ss.clear();
+    }
+    for (map<string, int>::iterator i = item_ids.begin(); i != item_ids.end(); ++i) {
+        i->second = items.size();
+        items.push_back(i->first);
+    }
+
+    for (map<string, float>::iterator i = dictionary.begin(); i != dictionary.end(); ++i) {
+        itemset.clear();
+        ss << i->first;
+        while(getline (ss, item, ' ')) {
+            itemset.push_back(item_ids[item]);
+        }
+        ss.clear();
+
+        itemsets.push_back(itemset);
+        supports.push_back(i->second);
+    }
+}
+
+// rules of one itemset, appended to buffer in the given format
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::itemset_rules(vector<Item> &itemset, float support, int n_rows, vector<string> &items, unordered_map<vector<Item>, float, ItemsetHash> &support_table, float min_confidence, float min_lift, int format, vector<char> &buffer){
+    vector< vector<Item> > consequents;
+    vector< vector<Item> > kept;
+    vector<Item> antecedent;
+    vector<Item> candidate;
+    vector<Item> subset;
+    typename unordered_map<vector<Item>, float, ItemsetHash>::iterator found;
+    string header;
+    long long count = (long long)(support*double(n_rows) + 0.5);
+    long long antecedent_count;
+    float antecedent_support;
+    float consequent_support;
+    float conf;
+    float lift;
+    bool closed;
+
+    if(format == RULES_TEXT){
+        header = "---------------\n\e[1m" + itemset_name(itemset, items) + "\e[0m\n---------------\n";
+        buffer.insert(buffer.end(), header.begin(), header.end());
+    }
+
+    // consequents of one item
+    for (size_t i = 0; i < itemset.size(); i++){
+        consequents.push_back(vector<Item>(1, itemset[i]));
+    }
+
+    while(!consequents.empty() && consequents[0].size() < itemset.size()){
+        kept.clear();
+        for (size_t i = 0; i < consequents.size(); i++){
+            antecedent.clear();
+            set_difference(itemset.begin(), itemset.end(), consequents[i].begin(), consequents[i].end(), back_inserter(antecedent));
+
+            // find, not operator[]: the table is shared by the threads and must not grow
+            found = support_table.find(antecedent);
+            if(found == support_table.end()) continue;
+            antecedent_support = found->second;
+            // the confidence of the integer counts: the ratio of two normalised supports can fall just below a
+            // threshold it meets exactly, and so can min_confidence*antecedent_count above, by the rounding of
+            // min_confidence to a float
+            antecedent_count = (long long)(antecedent_support*double(n_rows) + 0.5);
+            if(count < min_confidence*double(antecedent_count)*(1 - CONFIDENCE_TOLERANCE)) continue;
+            conf = double(count)/double(antecedent_count);
+
+            found = support_table.find(consequents[i]);
+            if(found == support_table.end()) continue;
+            kept.push_back(consequents[i]);
+            consequent_support = found->second;
+            lift = conf/consequent_support;
+            if(lift >= min_lift){
+                write_rule(buffer, format, antecedent, consequents[i], items, support, conf, lift, support - antecedent_support*consequent_support);
+            }
+        }
+
+        // join the kept consequents that share all items but the last one, keeping the candidates whose
+        // subsets were all kept; kept is sorted, as consequents
+        consequents.clear();
+        for (size_t i = 0; i < kept.size(); i++){
+            for (size_t j = i+1; j < kept.size() && equal(kept[i].begin(), kept[i].end()-1, kept[j].begin()); j++){
+                candidate = kept[i];
+                candidate.push_back(kept[j].back());
+
+                closed = true;
+                for (size_t r = 0; r+2 < candidate.size() && closed; r++){
+                    subset = candidate;
+                    subset.erase(subset.begin() + r);
+                    closed = binary_search(kept.begin(), kept.end(), subset);
+                }
+                if(closed){
+                    consequents.push_back(candidate);
+                }
+            }
+        }
+    }
+}
+
+// write dictionary to out_file in the given format, instead of printing it from rank 0: every rank gets
+// the itemsets of rank 0, formats a contiguous block of them and writes it at its offset in the file, so
+// that the file is the same whatever the policy
+template <class Policy>
+void Apriori<Policy>::write_itemsets(map<string,float> &dictionary, int n_rows, char out_file[], int format, int my_rank, int comm_sz){
+    vector<char> buffer;
+    long long offset;
+
+    Policy::share_dictionary(dictionary, my_rank);
+    if(narrow_ids(dictionary)){
+        format_itemsets<uint16_t>(dictionary, n_rows, format, my_rank, comm_sz, buffer);
+    }
+    else{
+        format_itemsets<uint32_t>(dictionary, n_rows, format, my_rank, comm_sz, buffer);
+    }
+
+    offset = Policy::exclusive_sum((long long)buffer.size());
+    if(!Policy::write_file(out_file, offset, buffer)){
+        if(my_rank == 0){
+            cerr<<out_file<<": cannot be written"<<endl;
+        }
+        Policy::abort();
+    }
+}
+
+// the block of itemsets of this rank, with rank 0 adding the header, formatted into buffer with item ids of
+// type Item
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::format_itemsets(map<string,float> &dictionary, int n_rows, int format, int my_rank, int comm_sz, vector<char> &buffer){
+    vector<string> items;
+    vector< vector<Item> > itemsets;
+    vector<float> supports;
+    int local_start, local_end;
+
+    build_itemset_table(dictionary, items, itemsets, supports);
+    if(my_rank == 0){
+        write_itemsets_header(buffer, format, items, n_rows);
+    }
+
+    local_start = (long long)itemsets.size()*my_rank/comm_sz;
+    local_end = (long long)itemsets.size()*(my_rank+1)/comm_sz;
+
+    // static scheduling gives each thread a contiguous block, appended in thread order
+    vector< vector<char> > thread_buffers(Policy::max_threads());
+    #pragma omp parallel
+    {
+        vector<char> &thread_buffer = thread_buffers[Policy::thread_num()];
+
+        #pragma omp for schedule(static)
+        for (int i = local_start; i < local_end; i++){
+            format_itemset(thread_buffer, format, itemsets[i], items, supports[i], n_rows);
+        }
+    }
+    for (size_t t = 0; t < thread_buffers.size(); t++){
+        buffer.insert(buffer.end(), thread_buffers[t].begin(), thread_buffers[t].end());
+    }
+}
+
+// append one itemset to buffer: a TSV line as the printed output, a JSON object per line, or in the
+// binary format its size, its item ids and its count
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::format_itemset(vector<char> &buffer, int format, vector<Item> &itemset, vector<string> &items, float support, int n_rows){
+    char numbers[64];
+    string line;
+    int count = int(support*double(n_rows) + 0.5);
+    int size;
+
+    if(format == ITEMSETS_BINARY){
+        size = itemset.size();
+        buffer.insert(buffer.end(), (char*)&size, (char*)&size + sizeof(int));
+        append_ids(buffer, itemset);
+        buffer.insert(buffer.end(), (char*)&count, (char*)&count + sizeof(int));
+        return;
+    }
+
+    if(format == ITEMSETS_JSONL){
+        line = "{\"items\":[";
+        for (size_t i = 0; i < itemset.size(); i++){
+            if(i > 0) line += ",";
+            line += "\"";
+            for (size_t j = 0; j < items[itemset[i]].size(); j++){
+                if(items[itemset[i]][j] == '"' || items[itemset[i]][j] == '\\') line += '\\';
+                line += items[itemset[i]][j];
+            }
+            line += "\"";
+        }
+        snprintf(numbers, sizeof(numbers), "],\"support\":%g,\"count\":%d}\n", support, count);
+    }
+    else{
+        line = itemset_name(itemset, items);
+        snprintf(numbers, sizeof(numbers), "\t%g\n", support);
+    }
+    buffer.insert(buffer.end(), line.begin(), line.end());
+    buffer.insert(buffer.end(), numbers, numbers + strlen(numbers));
+}
+
+// first bytes of an itemsets output: the header line of the TSV format, the number of rows and the item
+// table of the binary one
+template <class Policy>
+void Apriori<Policy>::write_itemsets_header(vector<char> &buffer, int format, vector<string> &items, int n_rows){
+    string header;
+    int size;
+
+    if(format == ITEMSETS_TSV){
+        header = "KEY\tVALUE\n";
+        buffer.insert(buffer.end(), header.begin(), header.end());
+    }
+    else if(format == ITEMSETS_BINARY){
+        buffer.insert(buffer.end(), ITEMSETS_MAGIC, ITEMSETS_MAGIC + 8);
+        buffer.insert(buffer.end(), (char*)&n_rows, (char*)&n_rows + sizeof(int));
+        size = items.size();
+        buffer.insert(buffer.end(), (char*)&size, (char*)&size + sizeof(int));
+        for (size_t i = 0; i < items.size(); i++){
+            size = items[i].size();
+            buffer.insert(buffer.end(), (char*)&size, (char*)&size + sizeof(int));
+            buffer.insert(buffer.end(), items[i].begin(), items[i].end());
+        }
+    }
+}
+
+// first bytes of a rules output: the column names of the TSV format, the item table of the binary one
+template <class Policy>
+void Apriori<Policy>::write_rules_header(vector<char> &buffer, int format, vector<string> &items){
+    string header;
+    int size;
+
+    if(format == RULES_TSV){
+        header = "ANTECEDENT\tCONSEQUENT\tSUPPORT\tCONFIDENCE\tLIFT\tLEVERAGE\n";
+        buffer.insert(buffer.end(), header.begin(), header.end());
+    }
+    else if(format == RULES_BINARY){
+        buffer.insert(buffer.end(), RULES_MAGIC, RULES_MAGIC + 8);
+        size = items.size();
+        buffer.insert(buffer.end(), (char*)&size, (char*)&size + sizeof(int));
+        for (size_t i = 0; i < items.size(); i++){
+            size = items[i].size();
+            buffer.insert(buffer.end(), (char*)&size, (char*)&size + sizeof(int));
+            buffer.insert(buffer.end(), items[i].begin(), items[i].end());
+        }
+    }
+}
+
+// append one rule to buffer: a line of text or TSV, or in the binary format the sizes of antecedent and
+// consequent, their item ids, then support, confidence, lift and leverage as floats
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::write_rule(vector<char> &buffer, int format, vector<Item> &antecedent, vector<Item> &consequent, vector<string> &items, float support, float conf, float lift, float leverage){
+    char numbers[128];
+    string line;
+    int size;
+    float values[4] = {support, conf, lift, leverage};
+
+    if(format == RULES_BINARY){
+        size = antecedent.size();
+        buffer.insert(buffer.end(), (char*)&size, (char*)&size + sizeof(int));
+        size = consequent.size();
+        buffer.insert(buffer.end(), (char*)&size, (char*)&size + sizeof(int));
+        append_ids(buffer, antecedent);
+        append_ids(buffer, consequent);
+        buffer.insert(buffer.end(), (char*)values, (char*)values + sizeof(values));
+        return;
+    }
+
+    if(format == RULES_TSV){
+        line = itemset_name(antecedent, items) + "\t" + itemset_name(consequent, items);
+        snprintf(numbers, sizeof(numbers), "\t%g\t%g\t%g\t%g\n", support, conf, lift, leverage);
+    }
+    else{
+        line = itemset_name(antecedent, items) + " -> " + itemset_name(consequent, items);
+        snprintf(numbers, sizeof(numbers), " : %g, lift: %g, leverage: %g\n", conf, lift, leverage);
+    }
+    buffer.insert(buffer.end(), line.begin(), line.end());
+    buffer.insert(buffer.end(), numbers, numbers + strlen(numbers));
+}
+
+// append ids to buffer as ints, the width of the ids in the binary formats whatever the type of Item
+template <class Policy>
+template <class Item>
+void Apriori<Policy>::append_ids(vector<char> &buffer, vector<Item> &ids){
+    int id;
+
+    for (size_t i = 0; i < ids.size(); i++){
+        id = ids[i];
+        buffer.insert(buffer.end(), (char*)&id, (char*)&id + sizeof(int));
+    }
+}
+
+template <class Policy>
+void Apriori<Policy>::flush_rules(vector<char> &buffer, FILE* out){
+    fwrite(buffer.data(), 1, buffer.size(), out);
+    buffer.clear();
+}
+
+template <class Policy>
+template <class Item>
+string Apriori<Policy>::itemset_name(vector<Item> &itemset, vector<string> &items){
+    string name;
+
+    for (size_t i = 0; i < itemset.size(); i++){
+        name += " " + items[itemset[i]];
+    }
+    name.erase(0,1);
+
+    return name;
+}
+
+#endif
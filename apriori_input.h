@@ -0,0 +1,370 @@
+// line input of the engine of apriori_engine.h: plain text files, and gzip compressed ones (name ending in .gz)
+// when built with -DAPRIORI_ZLIB and linked with -lz
+#ifndef APRIORI_INPUT_H
+#define APRIORI_INPUT_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string.h>
+#include <vector>
+#include <map>
+#include <deque>
+#include <stdio.h>
+#ifdef APRIORI_ZLIB
+#include <zlib.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+using namespace std;
+
+#ifdef APRIORI_ZLIB
+const int GZIP_BLOCK_SIZE = 1 << 20; // bytes decompressed at once from a gzip file that is not block compressed
+const int GZIP_BLOCKS_AHEAD = 64; // decompressed blocks waiting for the parser at most
+const int GZIP_MAX_WORKERS = 4; // threads decompressing the blocks of a BGZF file
+const int BGZF_HEADER_SIZE = 18; // gzip header of a BGZF block, whose extra field holds the block size
+const int BGZF_EOF_SIZE = 28; // empty block that ends a BGZF file, missing if the file was cut at a block boundary
+
+// decompression of a gzip file by other threads than the parser: the blocks of text come out in file order
+// through a bounded window, so that decompression stays ahead of parsing without holding the whole file. A
+// BGZF file (blocks of at most 64 KB, each a gzip member whose header gives its size, as written by bgzip) is
+// split by a reader thread and its blocks decompressed in parallel by the workers; any other gzip file,
+// multi-member included, is decompressed by a single thread
+class GzipPipeline{
+public:
+    GzipPipeline(const char* file_name){
+        next_block = 0;
+        blocks_read = 0;
+        finished = false;
+        stopped = false;
+        failed = false;
+
+        if(is_bgzf(file_name)){
+            int n_workers = max(1, min(GZIP_MAX_WORKERS, (int)thread::hardware_concurrency() - 1));
+
+            reader = thread(&GzipPipeline::split_blocks, this, string(file_name));
+            for (int i = 0; i < n_workers; i++){
+                workers.push_back(thread(&GzipPipeline::inflate_blocks, this));
+            }
+        }
+        else{
+            reader = thread(&GzipPipeline::inflate_stream, this, string(file_name));
+        }
+    }
+
+    ~GzipPipeline(){
+        {
+            lock_guard<mutex> lock(m);
+            stopped = true;
+        }
+        space.notify_all();
+        jobs_ready.notify_all();
+        reader.join();
+        for (size_t i = 0; i < workers.size(); i++){
+            workers[i].join();
+        }
+    }
+
+    // the next block of text in file order, false once the file is over
+    bool next(vector<char> &block){
+        unique_lock<mutex> lock(m);
+
+        results_ready.wait(lock, [this]{ return results.count(next_block) > 0 || (finished && next_block >= blocks_read); });
+        if(results.count(next_block) == 0) return false;
+
+        block.swap(results[next_block]);
+        results.erase(next_block++);
+        space.notify_all();
+        return true;
+    }
+
+    bool error(){ return failed; }
+
+private:
+    thread reader;
+    vector<thread> workers;
+    mutex m;
+    condition_variable space; // a block left the window
+    condition_variable jobs_ready; // a compressed block to decompress, or the end of the file
+    condition_variable results_ready;
+    deque< pair<long long, vector<char> > > jobs;
+    map< long long, vector<char> > results;
+    long long next_block; // next block handed to the parser
+    long long blocks_read; // blocks read from the file
+    bool finished; // every block read from the file
+    bool stopped; // reader destroyed before the end of the file
+    bool failed;
+
+    // true if the first member of file_name has the extra field of a BGZF block
+    static bool is_bgzf(const char* file_name){
+        unsigned char header[BGZF_HEADER_SIZE];
+        FILE* in = fopen(file_name, "rb");
+        bool bgzf;
+
+        if(in == NULL) return false;
+        bgzf = fread(header, 1, BGZF_HEADER_SIZE, in) == BGZF_HEADER_SIZE && header[0] == 31 && header[1] == 139
+               && (header[3] & 4) && header[10] == 6 && header[12] == 'B' && header[13] == 'C' && header[14] == 2;
+        fclose(in);
+
+        return bgzf;
+    }
+
+    // wait for room in the window for block number seq, false if the pipeline is stopped
+    bool wait_space(unique_lock<mutex> &lock, long long seq){
+        space.wait(lock, [this, seq]{ return stopped || seq < next_block + GZIP_BLOCKS_AHEAD; });
+        return !stopped;
+    }
+
+    void finish(bool error){
+        lock_guard<mutex> lock(m);
+
+        finished = true;
+        failed = failed || error;
+        results_ready.notify_all();
+        jobs_ready.notify_all();
+    }
+
+    // single thread: gzread decompresses every member of the file into blocks of GZIP_BLOCK_SIZE bytes. A file
+    // cut short ends the reads without an error from gzread: it is caught by gzerror, or by the end of the file
+    // not being reached
+    void inflate_stream(string file_name){
+        gzFile in = gzopen(file_name.c_str(), "rb");
+        vector<char> block;
+        int size = 0;
+        int status = Z_OK;
+        bool error = in == NULL;
+
+        if(in != NULL){
+            gzbuffer(in, GZIP_BLOCK_SIZE);
+            while(true){
+                block.resize(GZIP_BLOCK_SIZE);
+                size = gzread(in, block.data(), GZIP_BLOCK_SIZE);
+                if(size <= 0){
+                    gzerror(in, &status);
+                    error = size < 0 || status != Z_OK || !gzeof(in);
+                    break;
+                }
+                block.resize(size);
+
+                unique_lock<mutex> lock(m);
+                if(!wait_space(lock, blocks_read)) break;
+                results[blocks_read++].swap(block);
+                results_ready.notify_all();
+            }
+            gzclose(in);
+        }
+
+        finish(error);
+    }
+
+    // reader of a BGZF file: every block is read whole, its size taken from its header, and queued for the workers.
+    // The file must end with the empty BGZF_EOF_SIZE block, otherwise it was cut at a block boundary
+    void split_blocks(string file_name){
+        FILE* in = fopen(file_name.c_str(), "rb");
+        vector<char> block;
+        unsigned char* header;
+        int size;
+        bool error = in == NULL;
+        bool eof_block = false; // the last block read is the empty end of file block
+
+        while(!error){
+            block.resize(BGZF_HEADER_SIZE);
+            size = fread(block.data(), 1, BGZF_HEADER_SIZE, in);
+            if(size == 0){
+                error = !eof_block;
+                break;
+            }
+
+            header = (unsigned char*)block.data();
+            if(size < BGZF_HEADER_SIZE || header[0] != 31 || header[1] != 139 || header[12] != 'B' || header[13] != 'C'){
+                error = true;
+                break;
+            }
+            size = header[16] + (header[17] << 8) + 1;
+            block.resize(size);
+            if((int)fread(block.data() + BGZF_HEADER_SIZE, 1, size - BGZF_HEADER_SIZE, in) != size - BGZF_HEADER_SIZE){
+                error = true;
+                break;
+            }
+            eof_block = size == BGZF_EOF_SIZE && block[size-4] == 0 && block[size-3] == 0 && block[size-2] == 0 && block[size-1] == 0;
+
+            unique_lock<mutex> lock(m);
+            if(!wait_space(lock, blocks_read)) break;
+            jobs.push_back(make_pair(blocks_read++, vector<char>()));
+            jobs.back().second.swap(block);
+            jobs_ready.notify_one();
+        }
+        if(in != NULL) fclose(in);
+
+        finish(error);
+    }
+
+    // worker of a BGZF file: decompress the queued blocks, each a complete gzip member whose last 4 bytes give
+    // the size of its text
+    void inflate_blocks(){
+        pair<long long, vector<char> > job;
+        vector<char> text;
+        z_stream stream;
+        unsigned int size;
+        bool error;
+
+        while(true){
+            {
+                unique_lock<mutex> lock(m);
+                jobs_ready.wait(lock, [this]{ return stopped || finished || !jobs.empty(); });
+                if(jobs.empty()) return;
+                job.first = jobs.front().first;
+                job.second.swap(jobs.front().second);
+                jobs.pop_front();
+            }
+
+            vector<char> &block = job.second;
+            size = (unsigned char)block[block.size()-4] | (unsigned char)block[block.size()-3] << 8
+                   | (unsigned char)block[block.size()-2] << 16 | (unsigned int)(unsigned char)block[block.size()-1] << 24;
+            text.resize(size + 1); // room for the end of stream of an empty block
+
+            memset(&stream, 0, sizeof(stream));
+            inflateInit2(&stream, 15 + 16);
+            stream.next_in = (Bytef*)block.data();
+            stream.avail_in = block.size();
+            stream.next_out = (Bytef*)text.data();
+            stream.avail_out = size + 1;
+            error = inflate(&stream, Z_FINISH) != Z_STREAM_END || stream.total_out != size;
+            inflateEnd(&stream);
+            text.resize(size);
+
+            lock_guard<mutex> lock(m);
+            failed = failed || error;
+            results[job.first].swap(text);
+            results_ready.notify_all();
+        }
+    }
+};
+#endif
+
+// the lines of a text file read with getline as from an ifstream, or of a gzip file decompressed by a
+// GzipPipeline while the caller parses them. failed() tells whether the lines read so far are all of the file
+class LineReader{
+public:
+    LineReader(const char* file_name){
+        compressed = false;
+#ifdef APRIORI_ZLIB
+        pipeline = NULL;
+#endif
+        open(file_name);
+    }
+
+    ~LineReader(){
+        close();
+    }
+
+    // read file_name from its first line, closing the file read before
+    void open(const char* file_name){
+        int length = strlen(file_name);
+
+        close();
+        compressed = length > 3 && strcmp(file_name + length - 3, ".gz") == 0;
+        block.clear();
+        pos = 0;
+#ifdef APRIORI_ZLIB
+        if(compressed){
+            pipeline = new GzipPipeline(file_name);
+            return;
+        }
+#else
+        if(compressed){
+            return;
+        }
+#endif
+        plain.clear();
+        plain.open(file_name);
+    }
+
+    // true if the file could not be opened, is compressed without gzip support, or its decompression failed
+    bool failed(){
+        if(!compressed){
+            return !plain.is_open() || plain.bad();
+        }
+#ifdef APRIORI_ZLIB
+        return pipeline == NULL || pipeline->error();
+#else
+        return true;
+#endif
+    }
+
+    // why file_name cannot be read, empty if it can: checked before reading it
+    static string check(const char* file_name){
+        FILE* in;
+
+#ifndef APRIORI_ZLIB
+        int length = strlen(file_name);
+        if(length > 3 && strcmp(file_name + length - 3, ".gz") == 0){
+            return string(file_name) + ": gzip input needs a build with -DAPRIORI_ZLIB -lz";
+        }
+#endif
+        in = fopen(file_name, "rb");
+        if(in == NULL){
+            return string(file_name) + ": cannot be opened";
+        }
+        fclose(in);
+
+        return "";
+    }
+
+    bool getline(string &line){
+        if(!compressed){
+            return (bool)std::getline(plain, line);
+        }
+#ifdef APRIORI_ZLIB
+        if(pipeline == NULL) return false;
+
+        // the line may continue in the next blocks
+        line.clear();
+        while(true){
+            char* start = block.data() + pos;
+            char* newline = (char*)memchr(start, '\n', block.size() - pos);
+
+            if(newline != NULL){
+                line.append(start, newline - start);
+                pos = newline - block.data() + 1;
+                return true;
+            }
+            line.append(start, block.size() - pos);
+            pos = 0;
+            if(!pipeline->next(block)){
+                block.clear();
+                return !line.empty();
+            }
+        }
+#else
+        return false;
+#endif
+    }
+
+    void close(){
+        if(plain.is_open()){
+            plain.close();
+        }
+#ifdef APRIORI_ZLIB
+        delete pipeline;
+        pipeline = NULL;
+#endif
+    }
+
+private:
+    bool compressed;
+    ifstream plain;
+    vector<char> block; // decompressed text, read up to pos
+    size_t pos;
+#ifdef APRIORI_ZLIB
+    GzipPipeline* pipeline;
+#endif
+};
+
+// getline on a LineReader as on an ifstream
+inline bool getline(LineReader &reader, string &line){
+    return reader.getline(line);
+}
+
+#endif
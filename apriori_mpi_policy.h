@@ -0,0 +1,521 @@
+// execution policies of the MPI programs for the engine of apriori_engine.h: the ranks of MPI_COMM_WORLD, rank 0
+// holding the result, with OpenMP threads inside every rank for the hybrid program
+#ifndef APRIORI_MPI_POLICY_H
+#define APRIORI_MPI_POLICY_H
+
+// only the C interface is used: leave out the C++ bindings of Open MPI and MPICH
+#define OMPI_SKIP_MPICXX 1
+#define MPICH_SKIP_MPICXX 1
+#include <mpi.h>
+
+#include "apriori_engine.h"
+
+// ranks of MPI_COMM_WORLD, one thread each
+struct MPIPolicy{
+    static const bool distributed = true;
+    static const bool threads = false;
+
+    static const char* program(){ return "apriori_mpi"; }
+    static void init(int &my_rank, int &comm_sz);
+    static void finalize();
+    static void abort(){ MPI_Abort(MPI_COMM_WORLD, 1); }
+    static int max_threads(){ return 1; }
+    static int thread_num(){ return 0; }
+
+    static long long collect_itemsets(map<string,float> &temp_dictionary, int my_rank, int comm_sz);
+    static long long sum_itemsets(map<string,float> &temp_dictionary, MPI_Comm comm);
+    static void encode_itemset(const string &itemset, vector<unsigned int> &previous, vector<char> &buffer);
+    static bool decode_itemset(vector<char> &buffer, int &pos, vector<unsigned int> &items, string &itemset);
+    static bool numeric_items(const string &itemset, vector<unsigned int> &items);
+    static long long broadcast_itemsets(vector<string> &freq_itemsets, int my_rank);
+    static long long broadcast_itemsets(vector<string> &freq_itemsets, int my_rank, MPI_Comm comm);
+    static void share_dictionary(map<string,float> &dictionary, int my_rank);
+    static void gather_text(string &text, int my_rank, int comm_sz);
+    static void gather_tids(vector< vector<int> > &item_tids, int comm_sz);
+    static bool write_file(char file[], long long offset, vector<char> &buffer);
+
+    // the ranks of a node reduce through its leader (node rank 0), which also holds the candidates of -shared
+    static void node_comms(MPI_Comm &node, MPI_Comm &leaders);
+    static bool node_leader();
+    static long long broadcast_leaders(vector<string> &freq_itemsets, int my_rank);
+    static long long sum_node_counts(vector<int> &counts);
+    static const char* share_buffer(vector<char> &buffer);
+    static MPI_Win &shared_window();
+
+    // value of rank 0 on every rank
+    template <class T> static void broadcast(T &value){ MPI_Bcast(&value, 1, datatype(value), 0, MPI_COMM_WORLD); }
+    // sum of the values of every rank, on every rank
+    template <class T> static T sum_all(T value){
+        T total;
+        MPI_Allreduce(&value, &total, 1, datatype(value), MPI_SUM, MPI_COMM_WORLD);
+        return total;
+    }
+    // sum of the values of the lower ranks, 0 on rank 0
+    template <class T> static T exclusive_sum(T value){
+        T lower = 0;
+        int my_rank;
+        MPI_Exscan(&value, &lower, 1, datatype(value), MPI_SUM, MPI_COMM_WORLD);
+        MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+        return my_rank == 0 ? 0 : lower;
+    }
+    // element-wise reductions of n values on rank 0
+    template <class T> static void reduce_sum(T* values, T* result, int n){ MPI_Reduce(values, result, n, datatype(*values), MPI_SUM, 0, MPI_COMM_WORLD); }
+    template <class T> static void reduce_min(T* values, T* result, int n){ MPI_Reduce(values, result, n, datatype(*values), MPI_MIN, 0, MPI_COMM_WORLD); }
+    template <class T> static void reduce_max(T* values, T* result, int n){ MPI_Reduce(values, result, n, datatype(*values), MPI_MAX, 0, MPI_COMM_WORLD); }
+
+    static MPI_Datatype datatype(int){ return MPI_INT; }
+    static MPI_Datatype datatype(float){ return MPI_FLOAT; }
+    static MPI_Datatype datatype(double){ return MPI_DOUBLE; }
+    static MPI_Datatype datatype(long){ return MPI_LONG; }
+    static MPI_Datatype datatype(long long){ return MPI_LONG_LONG; }
+};
+
+#ifdef _OPENMP
+// ranks of MPI_COMM_WORLD with the OpenMP threads of each
+struct HybridPolicy : MPIPolicy{
+    static const bool threads = true;
+
+    static const char* program(){ return "apriori_mpi_omp"; }
+    static int max_threads(){ return omp_get_max_threads(); }
+    static int thread_num(){ return omp_get_thread_num(); }
+};
+#endif
+
+inline void MPIPolicy::init(int &my_rank, int &comm_sz){
+    MPI_Comm node, leaders;
+
+    MPI_Init(NULL, NULL);
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_sz);
+    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+    node_comms(node, leaders);
+}
+
+inline void MPIPolicy::finalize(){
+    if(shared_window() != MPI_WIN_NULL) MPI_Win_free(&shared_window());
+    MPI_Finalize();
+}
+
+// sum the itemsets counted by every rank into the temp_dictionary of rank 0, returning the bytes sent by this rank.
+// Two levels: the ranks of every node into their leader, then the leaders into rank 0, so that the traffic between
+// nodes grows with the nodes rather than with the ranks. On a single node this is the flat gather to rank 0
+inline long long MPIPolicy::collect_itemsets(map<string,float> &temp_dictionary, int, int){
+    MPI_Comm node, leaders;
+    long long bytes_sent;
+
+    node_comms(node, leaders);
+    bytes_sent = sum_itemsets(temp_dictionary, node);
+    if(leaders != MPI_COMM_NULL){
+        bytes_sent += sum_itemsets(temp_dictionary, leaders);
+    }
+
+    return bytes_sent;
+}
+
+// sum the itemsets of every rank of comm into the temp_dictionary of its rank 0, in rank order. Every rank sends
+// a single message: the number of itemsets, the itemsets coded by encode_itemset and their supports
+inline long long MPIPolicy::sum_itemsets(map<string,float> &temp_dictionary, MPI_Comm comm){
+    int my_rank, comm_sz;
+    vector<char> buffer;
+    vector<unsigned int> items;
+    string itemset;
+    unsigned int n_itemsets;
+    float support;
+    int count;
+    int pos;
+    long long bytes_sent = 0;
+
+    MPI_Comm_rank(comm, &my_rank);
+    MPI_Comm_size(comm, &comm_sz);
+    if(my_rank != 0){
+        Apriori<MPIPolicy>::encode_varint(temp_dictionary.size(), buffer);
+        for (map<string, float>::iterator i = temp_dictionary.begin(); i != temp_dictionary.end(); ++i) {
+            encode_itemset(i->first, items, buffer);
+        }
+        for (map<string, float>::iterator i = temp_dictionary.begin(); i != temp_dictionary.end(); ++i) {
+            buffer.insert(buffer.end(), (char*)&i->second, (char*)&i->second + sizeof(float));
+        }
+        MPI_Send(buffer.data(), buffer.size(), MPI_BYTE, 0, 0, comm);
+        bytes_sent = buffer.size();
+    }
+    else{
+        for(int i=1; i<comm_sz; i++){
+            MPI_Status status;
+            MPI_Probe(i, 0, comm, &status);
+            MPI_Get_count(&status, MPI_BYTE, &count);
+            buffer.resize(count);
+            MPI_Recv(buffer.data(), count, MPI_BYTE, i, 0, comm, MPI_STATUS_IGNORE);
+
+            // the supports follow the itemsets in the same order, the itemsets are sorted as in temp_dictionary
+            pos = 0;
+            Apriori<MPIPolicy>::decode_varint(buffer, pos, count, n_itemsets);
+            int support_pos = count - n_itemsets*sizeof(float);
+            map<string, float>::iterator hint = temp_dictionary.begin();
+            items.clear();
+            for (unsigned int j = 0; j < n_itemsets && decode_itemset(buffer, pos, items, itemset); j++){
+                memcpy(&support, &buffer[support_pos + j*sizeof(float)], sizeof(float));
+                hint = temp_dictionary.insert(hint, make_pair(itemset, 0.f));
+                hint->second += support;
+            }
+        }
+    }
+
+    return bytes_sent;
+}
+
+// send the itemsets of rank 0 to every rank, back down the hierarchy of collect_itemsets: to the node leaders,
+// then from every leader to the ranks of its node
+inline long long MPIPolicy::broadcast_itemsets(vector<string> &freq_itemsets, int){
+    MPI_Comm node, leaders;
+    int comm_rank;
+    long long bytes_sent = 0;
+
+    node_comms(node, leaders);
+    if(leaders != MPI_COMM_NULL){
+        MPI_Comm_rank(leaders, &comm_rank);
+        bytes_sent += broadcast_itemsets(freq_itemsets, comm_rank, leaders);
+    }
+    MPI_Comm_rank(node, &comm_rank);
+    bytes_sent += broadcast_itemsets(freq_itemsets, comm_rank, node);
+
+    return bytes_sent;
+}
+
+// send the itemsets of rank 0 of comm, my_rank being the rank in comm, to the other ranks of comm, coded by
+// encode_itemset after their number
+inline long long MPIPolicy::broadcast_itemsets(vector<string> &freq_itemsets, int my_rank, MPI_Comm comm){
+    vector<char> buffer;
+    vector<unsigned int> items;
+    string itemset;
+    unsigned int n_itemsets;
+    int count;
+    int pos = 0;
+
+    if(my_rank == 0){
+        Apriori<MPIPolicy>::encode_varint(freq_itemsets.size(), buffer);
+        for(size_t i=0; i<freq_itemsets.size(); i++) {
+            encode_itemset(freq_itemsets[i], items, buffer);
+        }
+        count = buffer.size();
+    }
+
+    MPI_Bcast(&count, 1, MPI_INT, 0, comm);
+    buffer.resize(count);
+    MPI_Bcast(buffer.data(), count, MPI_BYTE, 0, comm);
+
+    if(my_rank != 0){
+        Apriori<MPIPolicy>::decode_varint(buffer, pos, count, n_itemsets);
+        freq_itemsets.reserve(freq_itemsets.size() + n_itemsets);
+        for (unsigned int j = 0; j < n_itemsets && decode_itemset(buffer, pos, items, itemset); j++){
+            freq_itemsets.push_back(itemset);
+        }
+    }
+
+    // only rank 0 sends, the count and the itemsets
+    return my_rank == 0 ? sizeof(int) + count : 0;
+}
+
+// itemsets on the wire: a varint with the number of leading items shared with the previous itemset, times 2,
+// plus 1 when the itemset is sent as text, followed either by the length and the bytes of the text or by the
+// number of the other items and their values as varints. In sorted itemsets most of the items are shared with
+// the previous one, so that an itemset of level k takes a few bytes. previous holds the items of the previous
+// itemset, empty after one sent as text
+inline void MPIPolicy::encode_itemset(const string &itemset, vector<unsigned int> &previous, vector<char> &buffer){
+    vector<unsigned int> items;
+    size_t shared = 0;
+
+    if(!numeric_items(itemset, items)){
+        Apriori<MPIPolicy>::encode_varint(1, buffer);
+        Apriori<MPIPolicy>::encode_varint(itemset.size(), buffer);
+        buffer.insert(buffer.end(), itemset.begin(), itemset.end());
+        previous.clear();
+        return;
+    }
+
+    while(shared < items.size() && shared < previous.size() && items[shared] == previous[shared]){
+        shared++;
+    }
+    Apriori<MPIPolicy>::encode_varint(shared*2, buffer);
+    Apriori<MPIPolicy>::encode_varint(items.size() - shared, buffer);
+    for (size_t i = shared; i < items.size(); i++){
+        Apriori<MPIPolicy>::encode_varint(items[i], buffer);
+    }
+    previous.swap(items);
+}
+
+// read the itemset coded at buffer[pos] by encode_itemset, items holding the items of the previous one
+inline bool MPIPolicy::decode_itemset(vector<char> &buffer, int &pos, vector<unsigned int> &items, string &itemset){
+    unsigned int header;
+    unsigned int length;
+    unsigned int value;
+    char digits[10];
+    int n_digits;
+
+    if(!Apriori<MPIPolicy>::decode_varint(buffer, pos, buffer.size(), header)) return false;
+    if(!Apriori<MPIPolicy>::decode_varint(buffer, pos, buffer.size(), length)) return false;
+
+    if(header & 1){
+        itemset.assign(&buffer[pos], length);
+        pos += length;
+        items.clear();
+        return true;
+    }
+
+    items.resize(header/2);
+    for (unsigned int i = 0; i < length; i++){
+        if(!Apriori<MPIPolicy>::decode_varint(buffer, pos, buffer.size(), value)) return false;
+        items.push_back(value);
+    }
+
+    // print the items back, separated by spaces
+    itemset.clear();
+    for (size_t i = 0; i < items.size(); i++){
+        if(i > 0) itemset.push_back(' ');
+
+        value = items[i];
+        n_digits = 0;
+        do{
+            digits[n_digits++] = '0' + value % 10;
+            value /= 10;
+        } while(value > 0);
+        while(n_digits > 0){
+            itemset.push_back(digits[--n_digits]);
+        }
+    }
+
+    return true;
+}
+
+// the items of itemset as numbers, false unless each is a decimal number below 2^32 without leading zeros, so
+// that printing the numbers gives back itemset
+inline bool MPIPolicy::numeric_items(const string &itemset, vector<unsigned int> &items){
+    unsigned long long value = 0;
+    int digits = 0;
+
+    items.clear();
+    for (size_t i = 0; i <= itemset.size(); i++){
+        if(i == itemset.size() || itemset[i] == ' '){
+            if(digits == 0) return false;
+            items.push_back(value);
+            value = 0;
+            digits = 0;
+        }
+        else if(itemset[i] >= '0' && itemset[i] <= '9'){
+            if(digits == 1 && value == 0) return false;
+            value = value*10 + (itemset[i] - '0');
+            if(value > UINT_MAX) return false;
+            digits++;
+        }
+        else{
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// replace the dictionary of every rank with the itemsets and supports held by rank 0
+inline void MPIPolicy::share_dictionary(map<string,float> &dictionary, int my_rank){
+    vector<string> keys;
+    vector<float> values;
+
+    if(my_rank == 0){
+        for (map<string, float>::iterator i = dictionary.begin(); i != dictionary.end(); ++i) {
+            keys.push_back(i->first);
+            values.push_back(i->second);
+        }
+    }
+
+    broadcast_itemsets(keys, my_rank);
+    values.resize(keys.size());
+    MPI_Bcast(values.data(), values.size(), MPI_FLOAT, 0, MPI_COMM_WORLD);
+
+    if(my_rank != 0){
+        dictionary.clear();
+        for (size_t i = 0; i < keys.size(); i++){
+            dictionary[keys[i]] = values[i];
+        }
+    }
+}
+
+// concatenate the text of every rank on rank 0, in rank order
+inline void MPIPolicy::gather_text(string &text, int my_rank, int comm_sz){
+    int size = text.size();
+    vector<int> sizes(comm_sz);
+    vector<int> displs(comm_sz);
+    vector<char> all_text;
+
+    MPI_Gather(&size, 1, MPI_INT, sizes.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    if(my_rank == 0){
+        for(int r=0; r<comm_sz; r++){
+            displs[r] = r == 0 ? 0 : displs[r-1] + sizes[r-1];
+        }
+        all_text.resize(displs[comm_sz-1] + sizes[comm_sz-1] + 1);
+    }
+    MPI_Gatherv(&text[0], size, MPI_CHAR, all_text.data(), sizes.data(), displs.data(), MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    if(my_rank == 0){
+        text.assign(all_text.begin(), all_text.end() - 1);
+    }
+}
+
+// gather the tid-lists of every slice on every rank, in rank order so that they stay sorted
+inline void MPIPolicy::gather_tids(vector< vector<int> > &item_tids, int comm_sz){
+    vector<int> local_sizes;
+    vector<int> local_tids;
+    vector<int> sizes;
+    vector<int> rank_counts(comm_sz);
+    vector<int> displs(comm_sz);
+    vector<int> all_tids;
+    int n_items = item_tids.size();
+
+    for(int k=0; k<n_items; k++){
+        local_sizes.push_back(item_tids[k].size());
+        local_tids.insert(local_tids.end(), item_tids[k].begin(), item_tids[k].end());
+    }
+    sizes.resize(n_items*comm_sz);
+    MPI_Allgather(local_sizes.data(), n_items, MPI_INT, sizes.data(), n_items, MPI_INT, MPI_COMM_WORLD);
+
+    for(int r=0; r<comm_sz; r++){
+        rank_counts[r] = 0;
+        for(int k=0; k<n_items; k++){
+            rank_counts[r] += sizes[r*n_items + k];
+        }
+        displs[r] = r == 0 ? 0 : displs[r-1] + rank_counts[r-1];
+    }
+    all_tids.resize(displs[comm_sz-1] + rank_counts[comm_sz-1]);
+    MPI_Allgatherv(local_tids.data(), local_tids.size(), MPI_INT, all_tids.data(), &rank_counts[0], &displs[0], MPI_INT, MPI_COMM_WORLD);
+
+    int offset = 0;
+    for(int k=0; k<n_items; k++){
+        item_tids[k].clear();
+    }
+    for(int r=0; r<comm_sz; r++){
+        for(int k=0; k<n_items; k++){
+            item_tids[k].insert(item_tids[k].end(), all_tids.begin() + offset, all_tids.begin() + offset + sizes[r*n_items + k]);
+            offset += sizes[r*n_items + k];
+        }
+    }
+}
+
+// write the buffer of every rank at its offset of file with MPI-IO, the file truncated first. False on every
+// rank if it cannot be opened or one of the ranks fails to write its part (the file operations return their
+// errors, MPI_ERRORS_RETURN being the default handler of files)
+inline bool MPIPolicy::write_file(char file[], long long offset, vector<char> &buffer){
+    MPI_File out;
+    long long size = buffer.size();
+    int written;
+
+    // opening is collective and fails on every rank together
+    if(MPI_File_open(MPI_COMM_WORLD, file, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &out) != MPI_SUCCESS){
+        return false;
+    }
+    written = MPI_File_set_size(out, 0) == MPI_SUCCESS;
+    for (long long pos = 0; pos < size && written; pos += STREAM_BUFFER_SIZE){
+        written = MPI_File_write_at(out, offset + pos, buffer.data() + pos, min((long long)STREAM_BUFFER_SIZE, size - pos), MPI_CHAR, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    }
+    written = MPI_File_close(&out) == MPI_SUCCESS && written;
+
+    return sum_all(1 - written) == 0;
+}
+
+// ranks of the node of this one, split with MPI_COMM_TYPE_SHARED in rank order so that rank 0 leads its node,
+// and the node leaders, MPI_COMM_NULL on the other ranks. Split on the first call, made by init
+inline void MPIPolicy::node_comms(MPI_Comm &node, MPI_Comm &leaders){
+    static MPI_Comm node_comm = MPI_COMM_NULL;
+    static MPI_Comm leaders_comm = MPI_COMM_NULL;
+    static bool split = false;
+    int my_rank, node_rank;
+
+    if(!split){
+        MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, my_rank, MPI_INFO_NULL, &node_comm);
+        MPI_Comm_rank(node_comm, &node_rank);
+        MPI_Comm_split(MPI_COMM_WORLD, node_rank == 0 ? 0 : MPI_UNDEFINED, my_rank, &leaders_comm);
+        split = true;
+    }
+    node = node_comm;
+    leaders = leaders_comm;
+}
+
+inline bool MPIPolicy::node_leader(){
+    MPI_Comm node, leaders;
+
+    node_comms(node, leaders);
+    return leaders != MPI_COMM_NULL;
+}
+
+// broadcast_itemsets to the node leaders only, returning the bytes sent by this rank
+inline long long MPIPolicy::broadcast_leaders(vector<string> &freq_itemsets, int){
+    MPI_Comm node, leaders;
+    int leader_rank;
+
+    node_comms(node, leaders);
+    if(leaders == MPI_COMM_NULL) return 0;
+
+    MPI_Comm_rank(leaders, &leader_rank);
+    return broadcast_itemsets(freq_itemsets, leader_rank, leaders);
+}
+
+// sum the counts of the ranks of the node on its leader, returning the bytes sent by this rank. Every rank counts
+// on the same prefix tree, so the counts are added node by node; the other ranks are left with zeros, so that
+// only the leaders take part in the reduction of the itemsets across nodes
+inline long long MPIPolicy::sum_node_counts(vector<int> &counts){
+    MPI_Comm node, leaders;
+
+    node_comms(node, leaders);
+    if(leaders != MPI_COMM_NULL){
+        MPI_Reduce(MPI_IN_PLACE, counts.data(), counts.size(), MPI_INT, MPI_SUM, 0, node);
+        return 0;
+    }
+    MPI_Reduce(counts.data(), NULL, counts.size(), MPI_INT, MPI_SUM, 0, node);
+    fill(counts.begin(), counts.end(), 0);
+
+    return counts.size()*sizeof(int);
+}
+
+// copy the buffer of the node leader into the window allocated with MPI_Win_allocate_shared, returning where
+// every rank of the node reads it in place. The leader releases its buffer; the window is kept from one call to
+// the next and allocated again only when the buffer outgrows it
+inline const char* MPIPolicy::share_buffer(vector<char> &buffer){
+    static long long capacity = 0;
+    MPI_Comm node, leaders;
+    MPI_Win &window = shared_window();
+    long long needed = 0;
+    MPI_Aint size;
+    int disp_unit;
+    char* base;
+
+    node_comms(node, leaders);
+    if(leaders != MPI_COMM_NULL){
+        needed = buffer.size();
+    }
+    // allocating is collective on the node: every rank needs the size of the leader
+    MPI_Bcast(&needed, 1, MPI_LONG_LONG, 0, node);
+
+    if(window == MPI_WIN_NULL || needed > capacity){
+        if(window != MPI_WIN_NULL) MPI_Win_free(&window);
+        capacity = needed;
+        MPI_Win_allocate_shared(leaders != MPI_COMM_NULL ? needed : 0, 1, MPI_INFO_NULL, node, &base, &window);
+    }
+    MPI_Win_shared_query(window, 0, &size, &disp_unit, &base);
+
+    // the first fence waits for every rank of the node to be done with the previous buffer
+    MPI_Win_fence(0, window);
+    if(leaders != MPI_COMM_NULL){
+        memcpy(base, buffer.data(), needed);
+        vector<char>().swap(buffer);
+    }
+    MPI_Win_fence(0, window);
+
+    return base;
+}
+
+// window of the buffer shared by -shared
+inline MPI_Win &MPIPolicy::shared_window(){
+    static MPI_Win window = MPI_WIN_NULL;
+
+    return window;
+}
+
+#endif
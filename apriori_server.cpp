@@ -0,0 +1,441 @@
+#include "apriori_engine.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef Apriori<SerialPolicy> Engine; // each request is mined by a single thread of the pool
+
+const int MAX_REQUEST_SIZE = 1 << 16; // bytes of a request line at most
+const int CACHE_ENTRIES = 64; // default of -cache
+const int CLIENT_TIMEOUT = 30; // seconds a client may take to send its request or read the answer
+
+// the dataset loaded once and read by every request, never changed after loading
+struct Dataset{
+    vector< vector<string> > matrix;
+    map<string,float> item_counts;
+    int tot_lines;
+};
+
+// a mining request: one line of flags, as on the command line of the miners
+struct Request{
+    float min_support = -1;
+    int max_length = 0; // 0 = any length
+    vector<string> items; // items the mining is restricted to, sorted, empty = every item
+    bool rules = false;
+    float min_confidence = MIN_CONFIDENCE;
+    float min_lift = 0;
+    int format = -1; // -1 = TSV, otherwise ITEMSETS_JSONL or RULES_TEXT
+};
+
+// answers of the last requests by their parameters: a request already being mined is waited for instead of
+// being mined twice, and the oldest answers are evicted first
+struct Cache{
+    mutex m;
+    map< string, shared_future<string> > answers;
+    deque<string> order;
+    int max_entries;
+};
+
+// connections accepted and not yet answered, taken by the threads of the pool
+struct ClientQueue{
+    mutex m;
+    condition_variable ready;
+    deque<int> clients;
+};
+
+char* socket_file = NULL; // removed when the server is stopped
+
+void serve_clients(Dataset &dataset, Cache &cache, ClientQueue &queue);
+void answer_client(int client, Dataset &dataset, Cache &cache);
+bool read_request(int client, string &line);
+bool parse_request(string &line, Request &request, string &error);
+string request_key(Request &request);
+string answer_request(Request &request, Dataset &dataset);
+void mine_request(Request &request, Dataset &dataset, map<string,float> &dictionary);
+void send_all(int client, const string &text);
+void stop_server(int signal_number);
+
+// ------------------------------------------------------------
+// Main
+// ------------------------------------------------------------
+
+// resident miner: loads a dataset once and answers mining requests on a local Unix socket, each connection
+// sending one request line and reading the itemsets or rules as the miners write them with -out or -rules-out:
+// ./apriori_server <file> <socket file> [-threads n] [-cache entries]
+// request: -support s [-maxlen k] [-items a b ...] [-rules] [-confidence c] [-lift l] [-format tsv|jsonl|text]
+int main(int argc, char* argv[]){
+    Dataset dataset;
+    Cache cache;
+    ClientQueue queue;
+    vector<thread> pool;
+    int n_threads = max(1, (int)thread::hardware_concurrency());
+    struct sockaddr_un address;
+    int listener;
+    int client;
+
+    struct timeval start, end;
+    double elapsed;
+
+    if(argc < 3){
+        cout<<"Usage: "<<argv[0]<<" <file> <socket file> [-threads n] [-cache entries]"<<endl;
+        return 1;
+    }
+    socket_file = argv[2];
+    cache.max_entries = CACHE_ENTRIES;
+
+    // optional flags after file name and socket file
+    for(int i = 3; i < argc; i++){
+        if(strcmp(argv[i], "-threads") == 0 && i+1 < argc){
+            n_threads = max(1, atoi(argv[++i]));
+        }
+        else if(strcmp(argv[i], "-cache") == 0 && i+1 < argc){
+            cache.max_entries = max(0, atoi(argv[++i]));
+        }
+    }
+
+    if(strlen(socket_file) >= sizeof(address.sun_path)){
+        cerr<<socket_file<<": path too long for a Unix socket"<<endl;
+        return 1;
+    }
+
+    if(!LineReader::check(argv[1]).empty()){
+        cerr<<LineReader::check(argv[1])<<endl;
+        return 1;
+    }
+
+    gettimeofday(&start, NULL);
+
+    // read file into 2D vector matrix and insert 1-itemsets in item_counts as key with their frequency as value
+    Engine::read_file(argv[1], 0, INT_MAX, dataset.matrix, dataset.item_counts);
+    dataset.tot_lines = dataset.matrix.size();
+    if(dataset.tot_lines == 0){
+        cerr<<argv[1]<<": no rows to mine"<<endl;
+        return 1;
+    }
+
+    gettimeofday(&end, NULL);
+    elapsed = (end.tv_sec - start.tv_sec) +
+              ((end.tv_usec - start.tv_usec)/1000000.0);
+    cout<<"Loaded "<<dataset.tot_lines<<" rows in "<<elapsed<<" s"<<endl;
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_file);
+    unlink(socket_file);
+    if(listener < 0 || bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0){
+        cerr<<socket_file<<": cannot listen"<<endl;
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN); // a client that leaves early only fails its own send
+    signal(SIGINT, stop_server);
+    signal(SIGTERM, stop_server);
+
+    for (int t = 0; t < n_threads; t++){
+        pool.push_back(thread(serve_clients, ref(dataset), ref(cache), ref(queue)));
+    }
+    cout<<"Listening on "<<socket_file<<" with "<<n_threads<<" threads"<<endl;
+
+    while(true){
+        client = accept(listener, NULL, NULL);
+        if(client < 0) continue;
+
+        lock_guard<mutex> lock(queue.m);
+        queue.clients.push_back(client);
+        queue.ready.notify_one();
+    }
+
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Functions
+// ------------------------------------------------------------
+
+// thread of the pool: answer the accepted connections one at a time, a client that stops sending or reading
+// holding its thread for CLIENT_TIMEOUT seconds at most
+void serve_clients(Dataset &dataset, Cache &cache, ClientQueue &queue){
+    int client;
+    struct timeval timeout = {CLIENT_TIMEOUT, 0};
+
+    while(true){
+        {
+            unique_lock<mutex> lock(queue.m);
+            queue.ready.wait(lock, [&queue]{ return !queue.clients.empty(); });
+            client = queue.clients.front();
+            queue.clients.pop_front();
+        }
+
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        answer_client(client, dataset, cache);
+        close(client);
+    }
+}
+
+// read the request of client and send its answer, from the cache when the same parameters were asked before
+void answer_client(int client, Dataset &dataset, Cache &cache){
+    string line;
+    string error;
+    string key;
+    Request request;
+    promise<string> mined;
+    shared_future<string> answer;
+    bool miner = false;
+
+    if(!read_request(client, line)) return;
+    if(!parse_request(line, request, error)){
+        send_all(client, "ERROR " + error + "\n");
+        return;
+    }
+
+    key = request_key(request);
+    {
+        lock_guard<mutex> lock(cache.m);
+        map< string, shared_future<string> >::iterator it = cache.answers.find(key);
+
+        if(it != cache.answers.end()){
+            answer = it->second;
+        }
+        else{
+            answer = mined.get_future().share();
+            miner = true;
+            if(cache.max_entries > 0){
+                cache.answers[key] = answer;
+                cache.order.push_back(key);
+                if((int)cache.order.size() > cache.max_entries){
+                    cache.answers.erase(cache.order.front());
+                    cache.order.pop_front();
+                }
+            }
+        }
+    }
+
+    if(miner){
+        try{
+            mined.set_value(answer_request(request, dataset));
+        }
+        catch(...){
+            // the clients waiting for this answer get the error too, and a later request mines it again
+            mined.set_exception(current_exception());
+            lock_guard<mutex> lock(cache.m);
+            if(cache.answers.erase(key) > 0){
+                cache.order.erase(find(cache.order.begin(), cache.order.end(), key));
+            }
+        }
+    }
+
+    try{
+        send_all(client, answer.get());
+    }
+    catch(exception &e){
+        send_all(client, string("ERROR mining failed: ") + e.what() + "\n");
+    }
+    catch(...){
+        send_all(client, "ERROR mining failed\n");
+    }
+}
+
+// the first line sent by client, without its '\n'; false if the client closed the connection first
+bool read_request(int client, string &line){
+    char buffer[4096];
+    char* newline;
+    int size;
+
+    line.clear();
+    while(line.size() < MAX_REQUEST_SIZE){
+        size = recv(client, buffer, sizeof(buffer), 0);
+        if(size <= 0) return !line.empty();
+
+        newline = (char*)memchr(buffer, '\n', size);
+        if(newline != NULL){
+            line.append(buffer, newline - buffer);
+            break;
+        }
+        line.append(buffer, size);
+    }
+    line.erase(remove(line.begin(), line.end(), '\r'), line.end());
+
+    return true;
+}
+
+// the flags of a request line; false with the reason in error if a flag is unknown or a value out of range
+bool parse_request(string &line, Request &request, string &error){
+    stringstream ss;
+    vector<string> tokens;
+    string token;
+
+    ss << line;
+    while(ss >> token){
+        tokens.push_back(token);
+    }
+
+    for(size_t i = 0; i < tokens.size(); i++){
+        if(tokens[i] == "-support" && i+1 < tokens.size()){
+            request.min_support = atof(tokens[++i].c_str());
+        }
+        else if(tokens[i] == "-maxlen" && i+1 < tokens.size()){
+            request.max_length = atoi(tokens[++i].c_str());
+        }
+        else if(tokens[i] == "-items"){
+            // every item up to the next flag
+            while(i+1 < tokens.size() && tokens[i+1][0] != '-'){
+                request.items.push_back(tokens[++i]);
+            }
+        }
+        else if(tokens[i] == "-rules"){
+            request.rules = true;
+        }
+        else if(tokens[i] == "-confidence" && i+1 < tokens.size()){
+            request.min_confidence = atof(tokens[++i].c_str());
+        }
+        else if(tokens[i] == "-lift" && i+1 < tokens.size()){
+            request.min_lift = atof(tokens[++i].c_str());
+        }
+        else if(tokens[i] == "-format" && i+1 < tokens.size()){
+            i++;
+            request.format = tokens[i] == "jsonl" ? ITEMSETS_JSONL : tokens[i] == "text" ? RULES_TEXT : tokens[i] == "tsv" ? -1 : -2;
+            if(request.format == -2){
+                error = "unknown format " + tokens[i];
+                return false;
+            }
+        }
+        else{
+            error = "unknown flag " + tokens[i];
+            return false;
+        }
+    }
+
+    if(request.min_support <= 0 || request.min_support > 1){
+        error = "-support must be in (0, 1]";
+        return false;
+    }
+    if(request.max_length < 0){
+        error = "-maxlen must be >= 0";
+        return false;
+    }
+    if(request.rules && request.format == ITEMSETS_JSONL){
+        error = "rules are written as tsv or text";
+        return false;
+    }
+    if(!request.rules && request.format == RULES_TEXT){
+        error = "itemsets are written as tsv or jsonl";
+        return false;
+    }
+
+    sort(request.items.begin(), request.items.end());
+    request.items.erase(unique(request.items.begin(), request.items.end()), request.items.end());
+
+    return true;
+}
+
+// the parameters of request as text, equal for the requests with the same answer
+string request_key(Request &request){
+    char numbers[128];
+    string key;
+
+    snprintf(numbers, sizeof(numbers), "%.9g %d %d %d", request.min_support, request.max_length, request.rules ? 1 : 0, request.format);
+    key = numbers;
+    if(request.rules){
+        snprintf(numbers, sizeof(numbers), " %.9g %.9g", request.min_confidence, request.min_lift);
+        key += numbers;
+    }
+    for (size_t i = 0; i < request.items.size(); i++){
+        key += " " + request.items[i];
+    }
+
+    return key;
+}
+
+// the itemsets or rules of request, formatted as the miners write them
+string answer_request(Request &request, Dataset &dataset){
+    map<string,float> dictionary;
+    vector<char> buffer;
+
+    mine_request(request, dataset, dictionary);
+
+    if(request.rules){
+        int format = request.format == RULES_TEXT ? RULES_TEXT : RULES_TSV;
+
+        if(Engine::narrow_ids(dictionary)){
+            Engine::generate_rules<uint16_t>(dictionary, dataset.tot_lines, request.min_confidence, request.min_lift, format, NULL, false, 0, 1, buffer);
+        }
+        else{
+            Engine::generate_rules<uint32_t>(dictionary, dataset.tot_lines, request.min_confidence, request.min_lift, format, NULL, false, 0, 1, buffer);
+        }
+    }
+    else{
+        int format = request.format == ITEMSETS_JSONL ? ITEMSETS_JSONL : ITEMSETS_TSV;
+
+        if(Engine::narrow_ids(dictionary)){
+            Engine::format_itemsets<uint16_t>(dictionary, dataset.tot_lines, format, 0, 1, buffer);
+        }
+        else{
+            Engine::format_itemsets<uint32_t>(dictionary, dataset.tot_lines, format, 0, 1, buffer);
+        }
+    }
+
+    return string(buffer.begin(), buffer.end());
+}
+
+// level-wise mining of request into dictionary, as mine_matrix, on the items of the request only and up to its
+// max length. The rows of the dataset are shared by the requests: once level 1 is pruned each request mines the
+// levels from 2 with mine_levels on a copy of them trimmed to its 2-itemset candidates, as trim_rows does
+void mine_request(Request &request, Dataset &dataset, map<string,float> &dictionary){
+    vector<string> candidates;
+    vector<string> single_candidates;
+    vector<string> items;
+    vector< vector<string> > rows;
+    vector<string> key;
+    RunTrace trace;
+
+    if(request.items.empty()){
+        dictionary = dataset.item_counts;
+    }
+    else{
+        for (size_t i = 0; i < request.items.size(); i++){
+            map<string,float>::iterator it = dataset.item_counts.find(request.items[i]);
+            if(it != dataset.item_counts.end()) dictionary.insert(*it);
+        }
+    }
+
+    Engine::prune_itemsets(dictionary, candidates, request.min_support, dataset.tot_lines, 0, 1, single_candidates);
+    if(request.max_length == 1) return;
+
+    items = single_candidates;
+    sort(items.begin(), items.end());
+    for (size_t i = 0; i < dataset.matrix.size(); i++){
+        vector<string> row;
+
+        for (size_t j = 0; j < dataset.matrix[i].size(); j++){
+            if(binary_search(items.begin(), items.end(), dataset.matrix[i][j])) row.push_back(dataset.matrix[i][j]);
+        }
+        if(row.size() >= 2) rows.push_back(row);
+    }
+
+    // insert in dictionary all k-itemset, starting from 2-itemset
+    Engine::mine_levels(rows, dictionary, candidates, single_candidates, 2, dataset.tot_lines, request.min_support, request.max_length, 0, 0, 0, false, 0, 0, 1, NULL, false, key, trace);
+}
+
+void send_all(int client, const string &text){
+    size_t sent = 0;
+    ssize_t size;
+
+    while(sent < text.size()){
+        size = send(client, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if(size <= 0) return;
+        sent += size;
+    }
+}
+
+// SIGINT or SIGTERM: remove the socket file and exit
+void stop_server(int){
+    if(socket_file != NULL) unlink(socket_file);
+    _exit(0);
+}
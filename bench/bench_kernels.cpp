@@ -0,0 +1,146 @@
+#define APRIORI_NO_MAIN
+#include "../apriori.cpp"
+#include "bench_util.h"
+
+typedef Apriori<SerialPolicy> Engine; // the kernels of the serial version
+
+void bench_read_file(char data_file[], BenchDataset &dataset, int reps, vector< vector<string> > &matrix, map<string,float> &dictionary);
+void bench_levels(vector< vector<string> > &matrix, map<string,float> &dictionary, BenchDataset &dataset, float min_support, int max_k, int reps);
+void bench_rules(map<string,float> &dictionary, BenchDataset &dataset, float min_confidence, char rules_file[], int reps);
+
+// ------------------------------------------------------------
+// Main
+// ------------------------------------------------------------
+
+// micro-benchmarks of the kernels of the serial version on fixed synthetic datasets, printed as CSV:
+// ./bench_kernels [-reps R] [-scale f] [-support s] [-maxk k]
+int main(int argc, char* argv[]){
+    int reps = 3;
+    float scale = 1; // multiplies the rows of every dataset
+    float min_support = 0.05;
+    float min_confidence = 0.5;
+    int max_k = 4; // longest itemsets counted
+    BenchDataset datasets[] = {{"dense", 2000, 100, 8}, {"sparse", 2000, 2000, 8}};
+    char data_file[] = "bench_data.txt";
+    char rules_file[] = "bench_rules.tsv";
+    vector< vector<string> > matrix;
+    map<string,float> dictionary;
+
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "-reps") == 0 && i+1 < argc){
+            reps = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-scale") == 0 && i+1 < argc){
+            scale = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-support") == 0 && i+1 < argc){
+            min_support = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-maxk") == 0 && i+1 < argc){
+            max_k = atoi(argv[++i]);
+        }
+    }
+
+    report_header();
+    for (size_t d = 0; d < sizeof(datasets)/sizeof(datasets[0]); d++){
+        datasets[d].n_rows = int(datasets[d].n_rows*scale);
+        make_dataset(data_file, datasets[d]);
+
+        bench_read_file(data_file, datasets[d], reps, matrix, dictionary);
+        bench_levels(matrix, dictionary, datasets[d], min_support, max_k, reps);
+        bench_rules(dictionary, datasets[d], min_confidence, rules_file, reps);
+    }
+
+    remove(data_file);
+    remove(rules_file);
+
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Functions
+// ------------------------------------------------------------
+
+// read_file of the whole dataset, leaving in matrix and dictionary the result of the last repetition
+void bench_read_file(char data_file[], BenchDataset &dataset, int reps, vector< vector<string> > &matrix, map<string,float> &dictionary){
+    vector<double> times;
+    double start;
+
+    for (int r = 0; r < reps; r++){
+        matrix.clear();
+        dictionary.clear();
+        start = Engine::wall_time();
+        Engine::read_file(data_file, 0, INT_MAX, matrix, dictionary);
+        times.push_back(Engine::wall_time() - start);
+    }
+
+    report("read_file", dataset, 1, times, 0);
+}
+
+// count_itemsets over every row for each level up to max_k, and update_candidates on the frequent itemsets
+// of each level, as in mine_matrix; on exit dictionary holds the frequent itemsets up to max_k
+void bench_levels(vector< vector<string> > &matrix, map<string,float> &dictionary, BenchDataset &dataset, float min_support, int max_k, int reps){
+    map<string,float> temp_dictionary;
+    vector<string> candidates;
+    vector<string> single_candidates;
+    vector<string> freq_itemsets;
+    vector<string> next_candidates;
+    vector<string> next_singles;
+    vector<double> times;
+    double start;
+
+    Engine::prune_itemsets(dictionary, candidates, min_support, matrix.size(), 0, 1, single_candidates);
+
+    for (int k = 2; k <= max_k && !candidates.empty(); k++){
+        times.clear();
+        for (int r = 0; r < reps; r++){
+            temp_dictionary.clear();
+            start = Engine::wall_time();
+            Engine::count_itemsets(matrix, candidates, temp_dictionary);
+            times.push_back(Engine::wall_time() - start);
+        }
+        report("count_itemsets", dataset, k, times, 0);
+
+        freq_itemsets.clear();
+        for (map<string, float>::iterator it = temp_dictionary.begin(); it != temp_dictionary.end(); ){
+            it->second = it->second/float(matrix.size());
+            if (it->second < min_support){
+                temp_dictionary.erase(it++);
+            }
+            else{
+                freq_itemsets.push_back(it->first);
+                ++it;
+            }
+        }
+        dictionary.insert(temp_dictionary.begin(), temp_dictionary.end());
+        if(freq_itemsets.empty()) break;
+
+        // candidates of level k+1 from the frequent itemsets of level k
+        times.clear();
+        for (int r = 0; r < reps; r++){
+            next_candidates.clear();
+            next_singles.clear();
+            start = Engine::wall_time();
+            Engine::update_candidates(next_candidates, freq_itemsets, next_singles);
+            times.push_back(Engine::wall_time() - start);
+        }
+        report("update_candidates", dataset, k+1, times, 0);
+
+        candidates = next_candidates;
+        single_candidates = next_singles;
+    }
+}
+
+// generate_association_rules of the frequent itemsets, written as tsv to rules_file
+void bench_rules(map<string,float> &dictionary, BenchDataset &dataset, float min_confidence, char rules_file[], int reps){
+    vector<double> times;
+    double start;
+
+    for (int r = 0; r < reps; r++){
+        start = Engine::wall_time();
+        Engine::generate_association_rules(dictionary, dataset.n_rows, min_confidence, 0, rules_file, RULES_TSV, 0, 1);
+        times.push_back(Engine::wall_time() - start);
+    }
+
+    report("generate_association_rules", dataset, 0, times, 0);
+}
@@ -0,0 +1,120 @@
+#define APRIORI_NO_MAIN
+#include "../apriori_mpi.cpp"
+#include "bench_util.h"
+
+typedef Apriori<MPIPolicy> Engine; // the exchange of the MPI version
+
+void bench_prune_MPI(vector< vector<string> > &matrix, map<string,float> &dictionary, BenchDataset &dataset, float min_support, int max_k, int reps, int my_rank, int comm_sz);
+
+// ------------------------------------------------------------
+// Main
+// ------------------------------------------------------------
+
+// micro-benchmark of the exchange of prune_itemsets on fixed synthetic datasets, printed as CSV by rank 0:
+// mpirun -n <ranks> ./bench_mpi [-reps R] [-scale f] [-support s] [-maxk k]
+int main(int argc, char* argv[]){
+    MPI_Init(NULL, NULL);
+
+    int comm_sz;
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_sz);
+
+    int my_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
+
+    int reps = 3;
+    float scale = 1; // multiplies the rows of every dataset
+    float min_support = 0.05;
+    int max_k = 4; // longest itemsets counted
+    BenchDataset datasets[] = {{"dense", 2000, 100, 8}, {"sparse", 2000, 2000, 8}};
+    char data_file[] = "bench_data.txt";
+    vector< vector<string> > matrix;
+    map<string,float> dictionary;
+    int local_start, local_end;
+
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "-reps") == 0 && i+1 < argc){
+            reps = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-scale") == 0 && i+1 < argc){
+            scale = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-support") == 0 && i+1 < argc){
+            min_support = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-maxk") == 0 && i+1 < argc){
+            max_k = atoi(argv[++i]);
+        }
+    }
+
+    if(my_rank == 0){
+        report_header();
+    }
+    for (size_t d = 0; d < sizeof(datasets)/sizeof(datasets[0]); d++){
+        datasets[d].n_rows = int(datasets[d].n_rows*scale);
+        if(my_rank == 0){
+            make_dataset(data_file, datasets[d]);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        matrix.clear();
+        dictionary.clear();
+        Engine::compute_local_range(datasets[d].n_rows, my_rank, comm_sz, &local_start, &local_end);
+        Engine::read_file(data_file, local_start, local_end, matrix, dictionary);
+
+        bench_prune_MPI(matrix, dictionary, datasets[d], min_support, max_k, reps, my_rank, comm_sz);
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    if(my_rank == 0){
+        remove(data_file);
+    }
+
+    MPI_Finalize();
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Functions
+// ------------------------------------------------------------
+
+// prune_itemsets on the counts of every level up to max_k, each rank holding the counts of its slice of
+// the rows as in mine_matrix: reports the slowest rank and the bytes sent by all ranks in one call
+void bench_prune_MPI(vector< vector<string> > &matrix, map<string,float> &dictionary, BenchDataset &dataset, float min_support, int max_k, int reps, int my_rank, int comm_sz){
+    map<string,float> temp_dictionary;
+    map<string,float> counts;
+    vector<string> candidates;
+    vector<string> single_candidates;
+    vector<double> times;
+    double start, elapsed, max_elapsed;
+    long long total_bytes;
+
+    for (int k = 1; k <= max_k; k++){
+        if(k > 1){
+            if(candidates.empty()) break;
+            counts.clear();
+            Engine::count_itemsets(matrix, candidates, counts);
+        }
+        else{
+            counts = dictionary;
+        }
+
+        times.clear();
+        for (int r = 0; r < reps; r++){
+            LevelTrace level;
+
+            temp_dictionary = counts;
+            MPI_Barrier(MPI_COMM_WORLD);
+            start = Engine::wall_time();
+            Engine::prune_itemsets(temp_dictionary, candidates, min_support, dataset.n_rows, my_rank, comm_sz, single_candidates, level);
+            elapsed = Engine::wall_time() - start;
+
+            MPI_Reduce(&elapsed, &max_elapsed, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+            MPI_Reduce(&level.bytes_sent, &total_bytes, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+            times.push_back(max_elapsed);
+        }
+
+        if(my_rank == 0){
+            report("prune_itemsets", dataset, k, times, total_bytes);
+        }
+    }
+}
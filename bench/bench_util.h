@@ -0,0 +1,73 @@
+// shared by the benchmark programs, included after the apriori source that provides the includes
+
+const int BENCH_SEED = 4242; // seed of the synthetic datasets, fixed so that runs are comparable
+const int BENCH_PATTERNS = 8; // itemsets planted in the rows, giving frequent itemsets up to length 5
+
+// a fixed synthetic dataset: rows of about avg_length items out of n_items, skewed towards the low ids
+struct BenchDataset{
+    const char* name;
+    int n_rows;
+    int n_items;
+    int avg_length;
+};
+
+// write dataset to file_name in the format of the input files: one row per line, items separated by spaces.
+// Half of the rows contain one of BENCH_PATTERNS planted itemsets, the rest of their items follow a Zipf-like
+// distribution, so that the density is set by n_items and avg_length
+void make_dataset(char file_name[], BenchDataset &dataset){
+    mt19937 generator(BENCH_SEED);
+    poisson_distribution<int> length_distribution(dataset.avg_length);
+    uniform_real_distribution<double> uniform(0, 1);
+    vector< vector<int> > patterns(BENCH_PATTERNS);
+    vector<double> weights(dataset.n_items);
+    set<int> row;
+    int length;
+    FILE* out = fopen(file_name, "w");
+
+    for (int i = 0; i < dataset.n_items; i++){
+        weights[i] = 1./(i+1);
+    }
+    discrete_distribution<int> item_distribution(weights.begin(), weights.end());
+
+    for (int p = 0; p < BENCH_PATTERNS; p++){
+        length = 2 + p%4;
+        while((int)patterns[p].size() < length){
+            patterns[p].push_back(item_distribution(generator));
+        }
+    }
+
+    for (int r = 0; r < dataset.n_rows; r++){
+        row.clear();
+        if(uniform(generator) < 0.5){
+            vector<int> &pattern = patterns[generator() % BENCH_PATTERNS];
+            row.insert(pattern.begin(), pattern.end());
+        }
+        length = max(1, length_distribution(generator));
+        while((int)row.size() < min(length, dataset.n_items)){
+            row.insert(item_distribution(generator));
+        }
+
+        for (set<int>::iterator i = row.begin(); i != row.end(); ++i){
+            fprintf(out, "%s%d", i == row.begin() ? "" : " ", *i);
+        }
+        fprintf(out, "\n");
+    }
+
+    fclose(out);
+}
+
+double median(vector<double> times){
+    sort(times.begin(), times.end());
+
+    return times[times.size()/2];
+}
+
+// one CSV line per kernel and dataset: the median and the fastest of the repetitions
+void report(const char kernel[], BenchDataset &dataset, int k, vector<double> &times, long long bytes){
+    cout << kernel << ',' << dataset.name << ',' << dataset.n_rows << ',' << dataset.n_items << ',' << dataset.avg_length << ','
+         << k << ',' << times.size() << ',' << median(times) << ',' << *min_element(times.begin(), times.end()) << ',' << bytes << endl;
+}
+
+void report_header(){
+    cout << "kernel,dataset,rows,items,avg_length,k,reps,median_s,min_s,bytes\n";
+}
@@ -0,0 +1,364 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+using namespace std;
+
+const char* PHASES[] = {"count_time", "normalise_time", "prune_time", "reduce_time", "broadcast_time", "generation_time"}; // summed over the levels of the trace
+const int N_PHASES = 6;
+const int THRESHOLD_ROWS = 2000; // rows of the generated dataset with itemsets exactly at the threshold support
+const char THRESHOLD_SUPPORT[] = "0.05"; // 100 rows out of THRESHOLD_ROWS
+const char RULES_SUPPORT[] = "0.02"; // support of the rules run on the same dataset, 40 rows
+const char RULES_CONFIDENCE[] = "0.6"; // confidence of the rule 4 -> 5 of the generated dataset, 42 rows out of 70
+
+// one run of a variant on a dataset and support
+struct Run{
+    string variant;
+    int ranks;
+    int threads;
+    int rows;
+    double time; // total_time of the trace, the fastest of the repetitions
+    double load_time;
+    vector<double> phases;
+    bool match; // same itemsets as the serial version
+};
+
+void split_list(char list[], vector<string> &values);
+int run_grid(FILE* csv, string &dataset, string &support, vector<string> &thread_counts, vector<string> &rank_counts, string &bin_dir, string &mpirun, int reps, string &serial_output);
+void write_threshold_dataset(string &file_name);
+bool has_line(string &file_name, const char line[]);
+bool has_prefix(string &file_name, const char prefix[]);
+bool run_variant(string &command, string &output_file, string &trace_file, int reps, Run &run);
+bool read_trace(string &trace_file, Run &run);
+double json_value(string &text, const char key[]);
+double json_sum(string &text, const char key[]);
+bool same_file(string &file_a, string &file_b);
+void write_run(FILE* csv, string &dataset, string &support, Run &run, double serial_time);
+
+// ------------------------------------------------------------
+// Main
+// ------------------------------------------------------------
+
+// strong and weak scaling of the four versions on one machine, written as CSV:
+// ./scaling_driver -data a.txt,b.txt -support 0.01,0.02 [-threads 1,2,4] [-ranks 1,2,4] [-bin dir]
+//                  [-mpirun "mpirun"] [-reps n] [-csv scaling.csv]
+int main(int argc, char* argv[]){
+    vector<string> datasets;
+    vector<string> supports;
+    vector<string> thread_counts;
+    vector<string> rank_counts;
+    string bin_dir = ".";
+    string mpirun = "mpirun";
+    string csv_file = "scaling.csv";
+    int reps = 1;
+    string serial_output = "scaling_serial.out";
+    string output_file = "scaling_run.out";
+    string trace_file = "scaling_trace.json";
+    string threshold_file = "scaling_threshold.txt";
+    string rules_file = "scaling_rules.tsv";
+    string command;
+    string threshold_support;
+    FILE* csv;
+    int match;
+    bool all_match = true;
+
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "-data") == 0 && i+1 < argc){
+            split_list(argv[++i], datasets);
+        }
+        else if(strcmp(argv[i], "-support") == 0 && i+1 < argc){
+            split_list(argv[++i], supports);
+        }
+        else if(strcmp(argv[i], "-threads") == 0 && i+1 < argc){
+            split_list(argv[++i], thread_counts);
+        }
+        else if(strcmp(argv[i], "-ranks") == 0 && i+1 < argc){
+            split_list(argv[++i], rank_counts);
+        }
+        else if(strcmp(argv[i], "-bin") == 0 && i+1 < argc){
+            bin_dir = argv[++i];
+        }
+        else if(strcmp(argv[i], "-mpirun") == 0 && i+1 < argc){
+            mpirun = argv[++i];
+        }
+        else if(strcmp(argv[i], "-reps") == 0 && i+1 < argc){
+            reps = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-csv") == 0 && i+1 < argc){
+            csv_file = argv[++i];
+        }
+    }
+    if(datasets.empty() || supports.empty()){
+        cout<<"Usage: "<<argv[0]<<" -data a.txt,b.txt -support 0.01,0.02 [-threads 1,2,4] [-ranks 1,2,4] [-bin dir] [-mpirun \"mpirun\"] [-reps n] [-csv scaling.csv]"<<endl;
+        return 1;
+    }
+    if(thread_counts.empty()) thread_counts.push_back("1");
+    if(rank_counts.empty()) rank_counts.push_back("1");
+
+    csv = fopen(csv_file.c_str(), "w");
+    fprintf(csv, "variant,dataset,rows,support,ranks,threads,cores,time,speedup,efficiency,load_time");
+    for (int p = 0; p < N_PHASES; p++){
+        fprintf(csv, ",%s", PHASES[p]);
+    }
+    fprintf(csv, ",match\n");
+
+    // itemsets whose count is exactly the threshold: every split of the rows must keep them, so the supports
+    // must not depend on how the counts are summed
+    write_threshold_dataset(threshold_file);
+    threshold_support = THRESHOLD_SUPPORT;
+    match = run_grid(csv, threshold_file, threshold_support, thread_counts, rank_counts, bin_dir, mpirun, 1, serial_output);
+    if(match < 0) return 1;
+    if(!has_line(serial_output, "1 2\t0.05")){
+        cout<<"The serial version lost the itemset at the threshold support of "<<threshold_file<<endl;
+        return 1;
+    }
+    all_match = all_match && match;
+    // a rule whose confidence is exactly the minimum must be kept as well
+    command = bin_dir + "/apriori " + threshold_file + " " + RULES_SUPPORT + " -rules-out " + rules_file + " -confidence " + RULES_CONFIDENCE + " > /dev/null";
+    if(system(command.c_str()) != 0 || !has_prefix(rules_file, "4\t5\t")){
+        cout<<"The serial version lost the rule at the threshold confidence of "<<threshold_file<<endl;
+        return 1;
+    }
+    remove(rules_file.c_str());
+    remove(threshold_file.c_str());
+
+    for (size_t d = 0; d < datasets.size(); d++){
+        for (size_t s = 0; s < supports.size(); s++){
+            match = run_grid(csv, datasets[d], supports[s], thread_counts, rank_counts, bin_dir, mpirun, reps, serial_output);
+            if(match < 0) return 1;
+            all_match = all_match && match;
+        }
+    }
+
+    fclose(csv);
+    remove(serial_output.c_str());
+    remove(output_file.c_str());
+    remove(trace_file.c_str());
+
+    if(!all_match){
+        cout<<"Some runs did not reproduce the itemsets of the serial version, see the match column of "<<csv_file<<endl;
+        return 1;
+    }
+    cout<<"All runs reproduced the itemsets of the serial version"<<endl;
+
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Functions
+// ------------------------------------------------------------
+
+// the serial version, then every other variant compared with it, on one dataset and support: 1 if all of
+// them reproduced the serial itemsets, 0 if not, -1 if the serial version failed
+int run_grid(FILE* csv, string &dataset, string &support, vector<string> &thread_counts, vector<string> &rank_counts, string &bin_dir, string &mpirun, int reps, string &serial_output){
+    string output_file = "scaling_run.out";
+    string trace_file = "scaling_trace.json";
+    string arguments = " " + dataset + " " + support;
+    string command;
+    Run serial;
+    Run run;
+    bool all_match = true;
+
+    // baseline: the serial version, whose itemsets every other run must reproduce
+    serial.variant = "apriori";
+    serial.ranks = serial.threads = 1;
+    command = bin_dir + "/apriori" + arguments;
+    if(!run_variant(command, serial_output, trace_file, reps, serial)){
+        cerr<<"Failed: "<<command<<endl;
+        return -1;
+    }
+    serial.match = true;
+    write_run(csv, dataset, support, serial, serial.time);
+
+    for (size_t t = 0; t < thread_counts.size(); t++){
+        run = Run();
+        run.variant = "apriori_omp";
+        run.ranks = 1;
+        run.threads = atoi(thread_counts[t].c_str());
+        command = "OMP_NUM_THREADS=" + thread_counts[t] + " " + bin_dir + "/apriori_omp" + arguments;
+        if(run_variant(command, output_file, trace_file, reps, run)){
+            run.match = same_file(serial_output, output_file);
+            write_run(csv, dataset, support, run, serial.time);
+        }
+        all_match = all_match && run.match;
+    }
+
+    for (size_t r = 0; r < rank_counts.size(); r++){
+        run = Run();
+        run.variant = "apriori_mpi";
+        run.ranks = atoi(rank_counts[r].c_str());
+        run.threads = 1;
+        command = mpirun + " -n " + rank_counts[r] + " " + bin_dir + "/apriori_mpi" + arguments;
+        if(run_variant(command, output_file, trace_file, reps, run)){
+            run.match = same_file(serial_output, output_file);
+            write_run(csv, dataset, support, run, serial.time);
+        }
+        all_match = all_match && run.match;
+
+        for (size_t t = 0; t < thread_counts.size(); t++){
+            run = Run();
+            run.variant = "apriori_mpi_omp";
+            run.ranks = atoi(rank_counts[r].c_str());
+            run.threads = atoi(thread_counts[t].c_str());
+            command = "OMP_NUM_THREADS=" + thread_counts[t] + " " + mpirun + " -n " + rank_counts[r] + " " + bin_dir + "/apriori_mpi_omp" + arguments;
+            if(run_variant(command, output_file, trace_file, reps, run)){
+                run.match = same_file(serial_output, output_file);
+                write_run(csv, dataset, support, run, serial.time);
+            }
+            all_match = all_match && run.match;
+        }
+    }
+
+    return all_match ? 1 : 0;
+}
+
+// THRESHOLD_ROWS rows where items 1 and 2, together, are in every 20th row, exactly THRESHOLD_SUPPORT of
+// them and spread over the slices of every rank; item 3 is in one of those rows less, just below it. Item 4
+// is in 70 other rows, item 5 in 42 of them, so that the rule 4 -> 5 has a confidence of exactly RULES_CONFIDENCE
+void write_threshold_dataset(string &file_name){
+    ofstream out (file_name.c_str());
+
+    for (int i = 0; i < THRESHOLD_ROWS; i++){
+        if(i % 20 == 0){
+            out << "1 2 ";
+            if(i < THRESHOLD_ROWS - 20) out << "3 ";
+        }
+        if(i % 28 == 1 && i/28 < 70){
+            out << "4 ";
+            if(i/28 % 5 < 3) out << "5 ";
+        }
+        out << 10 + i % 40 << ' ' << 50 + i % 37 << '\n';
+    }
+}
+
+// true if file_name has a line equal to line
+bool has_line(string &file_name, const char line[]){
+    ifstream in (file_name.c_str());
+    string text;
+
+    while(getline (in, text)) {
+        if(text == line) return true;
+    }
+
+    return false;
+}
+
+// true if file_name has a line starting with prefix
+bool has_prefix(string &file_name, const char prefix[]){
+    ifstream in (file_name.c_str());
+    string text;
+
+    while(getline (in, text)) {
+        if(text.compare(0, strlen(prefix), prefix) == 0) return true;
+    }
+
+    return false;
+}
+
+void split_list(char list[], vector<string> &values){
+    stringstream ss;
+    string value;
+
+    ss << list;
+    while(getline (ss, value, ',')) {
+        if(!value.empty()) values.push_back(value);
+    }
+}
+
+// run command reps times writing its itemsets to output_file and its trace to trace_file, keeping in run the
+// trace of the fastest repetition; false if the command failed
+bool run_variant(string &command, string &output_file, string &trace_file, int reps, Run &run){
+    string full_command = command + " -out " + output_file + " -trace " + trace_file + " > /dev/null";
+    Run repetition;
+
+    run.time = -1;
+    for (int r = 0; r < reps; r++){
+        cerr<<full_command<<endl;
+        remove(trace_file.c_str());
+        if(system(full_command.c_str()) != 0) return false;
+
+        repetition = run;
+        if(!read_trace(trace_file, repetition)) return false;
+        if(run.time < 0 || repetition.time < run.time){
+            run = repetition;
+        }
+    }
+
+    return true;
+}
+
+// total and load time, rows and the phases summed over the levels of a trace written with -trace
+bool read_trace(string &trace_file, Run &run){
+    ifstream trace (trace_file.c_str());
+    stringstream ss;
+    string text;
+
+    if(!trace) return false;
+    ss << trace.rdbuf();
+    text = ss.str();
+
+    run.rows = json_value(text, "rows");
+    run.time = json_value(text, "total_time");
+    run.load_time = json_value(text, "load_time");
+    run.phases.resize(N_PHASES);
+    for (int p = 0; p < N_PHASES; p++){
+        run.phases[p] = json_sum(text, PHASES[p]);
+    }
+
+    return true;
+}
+
+// number after the first "key": in text, 0 if missing
+double json_value(string &text, const char key[]){
+    string pattern = string("\"") + key + "\": ";
+    size_t pos = text.find(pattern);
+
+    if(pos == string::npos) return 0;
+
+    return atof(text.c_str() + pos + pattern.size());
+}
+
+// sum of the numbers after every "key": in text
+double json_sum(string &text, const char key[]){
+    string pattern = string("\"") + key + "\": ";
+    size_t pos = text.find(pattern);
+    double sum = 0;
+
+    while(pos != string::npos){
+        sum += atof(text.c_str() + pos + pattern.size());
+        pos = text.find(pattern, pos + pattern.size());
+    }
+
+    return sum;
+}
+
+bool same_file(string &file_a, string &file_b){
+    ifstream a (file_a.c_str(), ios::binary);
+    ifstream b (file_b.c_str(), ios::binary);
+    stringstream content_a, content_b;
+
+    if(!a || !b) return false;
+    content_a << a.rdbuf();
+    content_b << b.rdbuf();
+
+    return content_a.str() == content_b.str();
+}
+
+// speedup against the serial version and efficiency over the cores used (ranks times threads)
+void write_run(FILE* csv, string &dataset, string &support, Run &run, double serial_time){
+    int cores = run.ranks*run.threads;
+    double speedup = serial_time/run.time;
+
+    fprintf(csv, "%s,%s,%d,%s,%d,%d,%d,%g,%g,%g,%g", run.variant.c_str(), dataset.c_str(), run.rows, support.c_str(),
+            run.ranks, run.threads, cores, run.time, speedup, speedup/cores, run.load_time);
+    for (int p = 0; p < N_PHASES; p++){
+        fprintf(csv, ",%g", run.phases[p]);
+    }
+    fprintf(csv, ",%d\n", run.match ? 1 : 0);
+    fflush(csv);
+}
@@ -0,0 +1,221 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string.h>
+#include <vector>
+#include <sstream>
+#include <map>
+#include <algorithm>
+#include <sys/time.h>
+using namespace std;
+
+const char LATTICE_MAGIC[] = "APRLAT01"; // first 8 bytes of a lattice file
+
+bool read_header(ifstream &lattice, int &n_rows, float &floor_support, vector<string> &item_names, vector<long long> &offsets, vector<int> &sizes);
+int min_count(float support, int n_rows);
+int count_at(ifstream &lattice, long long offset, int record_size, int index);
+int find_section_end(ifstream &lattice, long long offset, int size, int length, int threshold);
+bool contains_items(vector<int> &record, vector<int> &filter);
+
+// ------------------------------------------------------------
+// Main
+// ------------------------------------------------------------
+
+// answers queries on a lattice written by the miners with -lattice:
+// ./lattice_query <lattice file> [-support s] [-length k] [-items "a b ..."]
+int main(int argc, char* argv[]){
+    char* lattice_file = argv[1];
+    float support = -1; // -1 = floor support of the lattice
+    int length = 0; // 0 = every length
+    vector<string> filter_items;
+    vector<int> filter;
+    vector<string> item_names;
+    vector<long long> offsets;
+    vector<int> sizes;
+    vector<int> record;
+    map<string,int> item_ids;
+    map<string,float> answer; // itemsets of the query, printed sorted by key like the miners
+    string key;
+    int n_rows;
+    float floor_support;
+    int threshold;
+    int end;
+    stringstream ss;
+    string item;
+
+    struct timeval start, stop;
+    double elapsed;
+
+    if(argc < 2){
+        cout<<"Usage: "<<argv[0]<<" <lattice file> [-support s] [-length k] [-items \"a b ...\"]"<<endl;
+        return 1;
+    }
+
+    // optional flags after the lattice file
+    for(int i = 2; i < argc; i++){
+        if(strcmp(argv[i], "-support") == 0 && i+1 < argc){
+            support = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-length") == 0 && i+1 < argc){
+            length = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-items") == 0 && i+1 < argc){
+            ss << argv[++i];
+            while(getline (ss, item, ' ')) {
+                if(!item.empty()) filter_items.push_back(item);
+            }
+            ss.clear();
+        }
+    }
+
+    gettimeofday(&start, NULL);
+
+    ifstream lattice (lattice_file, ios::binary);
+    if(!read_header(lattice, n_rows, floor_support, item_names, offsets, sizes)){
+        cout<<lattice_file<<" is not a lattice file"<<endl;
+        return 1;
+    }
+
+    if(support < 0){
+        support = floor_support;
+    }
+    if(support < floor_support){
+        cout<<"Support below the "<<floor_support<<" the lattice was mined with"<<endl;
+        return 1;
+    }
+
+    for (size_t i = 0; i < item_names.size(); i++){
+        item_ids[item_names[i]] = i;
+    }
+    // an item that is not in the lattice is in no frequent itemset
+    for (size_t i = 0; i < filter_items.size(); i++){
+        if(item_ids.find(filter_items[i]) == item_ids.end()){
+            sizes.assign(sizes.size(), 0);
+            break;
+        }
+        filter.push_back(item_ids[filter_items[i]]);
+    }
+
+    threshold = min_count(support, n_rows);
+
+    for (size_t l = 0; l < sizes.size(); l++){
+        if(length > 0 && (int)l+1 != length) continue;
+        if(l+1 < filter.size()) continue;
+
+        // records are sorted by decreasing count: only the head of the section is read
+        end = find_section_end(lattice, offsets[l], sizes[l], l+1, threshold);
+        record.resize(l+2);
+        lattice.seekg(offsets[l]);
+        for (int i = 0; i < end; i++){
+            lattice.read((char*)&record[0], record.size()*sizeof(int));
+            if(!contains_items(record, filter)) continue;
+
+            key = item_names[record[1]];
+            for (size_t j = 2; j < record.size(); j++){
+                key += ' ' + item_names[record[j]];
+            }
+            answer[key] = record[0]/float(n_rows);
+        }
+    }
+
+    cout<<"KEY\tVALUE\n";
+    for (map<string, float>::iterator itr = answer.begin(); itr != answer.end(); ++itr) {
+        cout << itr->first << '\t' << itr->second << '\n';
+    }
+
+    lattice.close();
+
+    gettimeofday(&stop, NULL);
+    elapsed = (stop.tv_sec - start.tv_sec) +
+              ((stop.tv_usec - start.tv_usec)/1000000.0);
+    cerr<<"Time passed: "<<elapsed<<endl;
+
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Functions
+// ------------------------------------------------------------
+
+// read the header, the item table and the index of the sections, leaving lattice at the first record
+bool read_header(ifstream &lattice, int &n_rows, float &floor_support, vector<string> &item_names, vector<long long> &offsets, vector<int> &sizes){
+    char magic[8];
+    int n_items;
+    int n_sections;
+    int length;
+    string name;
+
+    if(!lattice.read(magic, 8) || memcmp(magic, LATTICE_MAGIC, 8) != 0){
+        return false;
+    }
+    lattice.read((char*)&n_rows, sizeof(int));
+    lattice.read((char*)&floor_support, sizeof(float));
+    lattice.read((char*)&n_items, sizeof(int));
+    lattice.read((char*)&n_sections, sizeof(int));
+
+    for (int i = 0; i < n_items; i++){
+        lattice.read((char*)&length, sizeof(int));
+        name.resize(length);
+        lattice.read(&name[0], length);
+        item_names.push_back(name);
+    }
+
+    offsets.resize(n_sections);
+    sizes.resize(n_sections);
+    for (int i = 0; i < n_sections; i++){
+        lattice.read((char*)&offsets[i], sizeof(long long));
+        lattice.read((char*)&sizes[i], sizeof(int));
+    }
+
+    return (bool)lattice;
+}
+
+// lowest count whose support passes the same test used by the miners to prune
+int min_count(float support, int n_rows){
+    int count = int(support*n_rows);
+
+    while(count > 0 && (count-1)/float(n_rows) >= support) count--;
+    while(count/float(n_rows) < support) count++;
+
+    return count;
+}
+
+int count_at(ifstream &lattice, long long offset, int record_size, int index){
+    int count;
+
+    lattice.seekg(offset + (long long)index*record_size);
+    lattice.read((char*)&count, sizeof(int));
+
+    return count;
+}
+
+// binary search of the first record of the section with count < threshold
+int find_section_end(ifstream &lattice, long long offset, int size, int length, int threshold){
+    int record_size = (length+1)*sizeof(int);
+    int low = 0;
+    int high = size;
+    int mid;
+
+    while(low < high){
+        mid = (low + high)/2;
+        if(count_at(lattice, offset, record_size, mid) >= threshold){
+            low = mid + 1;
+        }
+        else{
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+// true if the item ids of record, after its count, include every id of filter
+bool contains_items(vector<int> &record, vector<int> &filter){
+    for (size_t i = 0; i < filter.size(); i++){
+        if(find(record.begin()+1, record.end(), filter[i]) == record.end()){
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,251 @@
+#include <iostream>
+#include <string>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <math.h>
+#include <stdio.h>
+#include <sys/time.h>
+using namespace std;
+
+const int OUTPUT_BUFFER_SIZE = 1 << 20; // bytes written to the output at once
+const float CORRELATION = 0.5; // mean fraction of its items a pattern takes from the previous pattern
+const float CORRUPTION_MEAN = 0.5, CORRUPTION_SD = 0.1; // items of a pattern dropped when it is used in a row
+const int MAX_ATTEMPTS = 4; // patterns tried per requested item before a row is given up as full
+
+// a potentially frequent itemset planted in the transactions
+struct Pattern{
+    vector<int> items;
+    float corruption;
+};
+
+void make_patterns(int n_patterns, float avg_pattern_length, int n_items, vector<double> &item_cumulative, mt19937 &generator, vector<Pattern> &patterns, vector<double> &pattern_cumulative);
+void make_item_distribution(int n_items, float zipf, vector<double> &item_cumulative);
+int pick_item(int n_items, vector<double> &item_cumulative, mt19937 &generator);
+int pick(vector<double> &cumulative, mt19937 &generator);
+void fill_row(vector<Pattern> &patterns, vector<double> &pattern_cumulative, int row_size, mt19937 &generator, int &pending, vector<char> &in_row, vector<int> &row);
+void write_row(vector<int> &row, vector<char> &buffer);
+
+// ------------------------------------------------------------
+// Main
+// ------------------------------------------------------------
+
+// synthetic transactions in the style of the IBM Quest generator (Agrawal and Srikant), written in the format
+// read by the miners: one transaction per line, items separated by spaces
+// ./quest_generator <output file|-> [-D transactions] [-T avg length] [-I avg pattern length] [-N items]
+//                   [-L patterns] [-zipf s] [-seed n]
+int main(int argc, char* argv[]){
+    long long n_rows = 100000; // D
+    float avg_length = 10; // T
+    float avg_pattern_length = 4; // I
+    int n_items = 1000; // N
+    int n_patterns = 2000; // L
+    float zipf = 0; // skew of the item popularity, 0 = uniform as in the original generator
+    int seed = 1;
+    vector<double> item_cumulative;
+    vector<double> pattern_cumulative;
+    vector<Pattern> patterns;
+    vector<char> in_row;
+    vector<int> row;
+    vector<char> buffer;
+    int pending = -1; // pattern that did not fit in the previous row
+    FILE* out;
+
+    struct timeval start, end;
+    double elapsed;
+
+    if(argc < 2){
+        cout<<"Usage: "<<argv[0]<<" <output file|-> [-D transactions] [-T avg length] [-I avg pattern length] [-N items] [-L patterns] [-zipf s] [-seed n]"<<endl;
+        return 1;
+    }
+
+    for(int i = 2; i < argc; i++){
+        if(strcmp(argv[i], "-D") == 0 && i+1 < argc){
+            n_rows = atoll(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-T") == 0 && i+1 < argc){
+            avg_length = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-I") == 0 && i+1 < argc){
+            avg_pattern_length = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-N") == 0 && i+1 < argc){
+            n_items = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-L") == 0 && i+1 < argc){
+            n_patterns = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-zipf") == 0 && i+1 < argc){
+            zipf = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "-seed") == 0 && i+1 < argc){
+            seed = atoi(argv[++i]);
+        }
+    }
+
+    gettimeofday(&start, NULL);
+
+    out = strcmp(argv[1], "-") == 0 ? stdout : fopen(argv[1], "wb");
+    if(out == NULL){
+        cerr<<"Cannot open "<<argv[1]<<endl;
+        return 1;
+    }
+
+    mt19937 generator(seed);
+    poisson_distribution<int> length_distribution(avg_length);
+
+    make_item_distribution(n_items, zipf, item_cumulative);
+    make_patterns(n_patterns, avg_pattern_length, n_items, item_cumulative, generator, patterns, pattern_cumulative);
+
+    in_row.assign(n_items, 0);
+    buffer.reserve(OUTPUT_BUFFER_SIZE + 1024);
+    for (long long r = 0; r < n_rows; r++){
+        fill_row(patterns, pattern_cumulative, max(1, length_distribution(generator)), generator, pending, in_row, row);
+        write_row(row, buffer);
+
+        if(buffer.size() >= OUTPUT_BUFFER_SIZE){
+            fwrite(buffer.data(), 1, buffer.size(), out);
+            buffer.clear();
+        }
+    }
+    fwrite(buffer.data(), 1, buffer.size(), out);
+
+    if(out != stdout) fclose(out);
+
+    gettimeofday(&end, NULL);
+    elapsed = (end.tv_sec - start.tv_sec) +
+              ((end.tv_usec - start.tv_usec)/1000000.0);
+    cerr<<"Time passed: "<<elapsed<<endl;
+
+    return 0;
+}
+
+// ------------------------------------------------------------
+// Functions
+// ------------------------------------------------------------
+
+// the patterns: sizes from a Poisson of mean avg_pattern_length, a fraction of the items (exponential of
+// mean CORRELATION) taken from the previous pattern and the rest picked from the item distribution, weights
+// from an exponential of mean 1 and a corruption level from a normal, as in the Quest generator
+void make_patterns(int n_patterns, float avg_pattern_length, int n_items, vector<double> &item_cumulative, mt19937 &generator, vector<Pattern> &patterns, vector<double> &pattern_cumulative){
+    poisson_distribution<int> size_distribution(avg_pattern_length);
+    exponential_distribution<double> correlation_distribution(1/CORRELATION);
+    exponential_distribution<double> weight_distribution(1);
+    normal_distribution<float> corruption_distribution(CORRUPTION_MEAN, CORRUPTION_SD);
+    double total_weight = 0;
+    int size;
+    int shared;
+    int item;
+
+    patterns.resize(n_patterns);
+    pattern_cumulative.resize(n_patterns);
+    for (int p = 0; p < n_patterns; p++){
+        size = min(n_items, max(1, size_distribution(generator)));
+
+        if(p > 0){
+            shared = min((int)patterns[p-1].items.size(), min(size, int(correlation_distribution(generator)*size)));
+            vector<int> previous = patterns[p-1].items;
+            shuffle(previous.begin(), previous.end(), generator);
+            patterns[p].items.assign(previous.begin(), previous.begin() + shared);
+        }
+        while(patterns[p].items.size() < size){
+            item = pick_item(n_items, item_cumulative, generator);
+            if(find(patterns[p].items.begin(), patterns[p].items.end(), item) == patterns[p].items.end()){
+                patterns[p].items.push_back(item);
+            }
+        }
+
+        patterns[p].corruption = min(1.f, max(0.f, corruption_distribution(generator)));
+        total_weight += weight_distribution(generator);
+        pattern_cumulative[p] = total_weight;
+    }
+}
+
+// cumulative distribution of the items: probability of the item of rank i proportional to 1/(i+1)^zipf
+void make_item_distribution(int n_items, float zipf, vector<double> &item_cumulative){
+    double total = 0;
+
+    item_cumulative.clear();
+    if(zipf <= 0) return;
+
+    item_cumulative.resize(n_items);
+    for (int i = 0; i < n_items; i++){
+        total += 1/pow(i+1., zipf);
+        item_cumulative[i] = total;
+    }
+}
+
+int pick_item(int n_items, vector<double> &item_cumulative, mt19937 &generator){
+    if(item_cumulative.empty()){
+        return generator() % n_items;
+    }
+
+    return pick(item_cumulative, generator);
+}
+
+// index drawn with the weights given as cumulative sums
+int pick(vector<double> &cumulative, mt19937 &generator){
+    double x = generate_canonical<double, 32>(generator) * cumulative.back();
+
+    return min((int)cumulative.size()-1, int(upper_bound(cumulative.begin(), cumulative.end(), x) - cumulative.begin()));
+}
+
+// a transaction of row_size items made of corrupted patterns: a pattern that does not fit is kept for the
+// next transaction half of the times, as in the Quest generator. in_row marks the items already in row
+void fill_row(vector<Pattern> &patterns, vector<double> &pattern_cumulative, int row_size, mt19937 &generator, int &pending, vector<char> &in_row, vector<int> &row){
+    uniform_real_distribution<float> uniform(0, 1);
+    vector<int> items;
+    int p;
+
+    row.clear();
+    for (int attempt = 0; attempt < MAX_ATTEMPTS*row_size && row.size() < row_size; attempt++){
+        p = pending >= 0 ? pending : pick(pattern_cumulative, generator);
+        pending = -1;
+
+        // drop items of the pattern while a uniform is below its corruption level
+        items = patterns[p].items;
+        while(!items.empty() && uniform(generator) < patterns[p].corruption){
+            items.erase(items.begin() + generator() % items.size());
+        }
+
+        if(!row.empty() && row.size() + items.size() > row_size && uniform(generator) < 0.5){
+            pending = p;
+            break;
+        }
+
+        for (int i = 0; i < items.size(); i++){
+            if(!in_row[items[i]]){
+                in_row[items[i]] = 1;
+                row.push_back(items[i]);
+            }
+        }
+    }
+
+    sort(row.begin(), row.end());
+    for (int i = 0; i < row.size(); i++){
+        in_row[row[i]] = 0;
+    }
+}
+
+// append row to buffer as a line of space separated items, formatting the numbers by hand
+void write_row(vector<int> &row, vector<char> &buffer){
+    char digits[12];
+    int n_digits;
+    int value;
+
+    for (int i = 0; i < row.size(); i++){
+        if(i > 0) buffer.push_back(' ');
+
+        value = row[i];
+        n_digits = 0;
+        do{
+            digits[n_digits++] = '0' + value % 10;
+            value /= 10;
+        } while(value > 0);
+        while(n_digits > 0){
+            buffer.push_back(digits[--n_digits]);
+        }
+    }
+    buffer.push_back('\n');
+}